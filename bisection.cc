@@ -0,0 +1,275 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#include "bisection.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Halves with fewer documents than this compute their gains in one thread.
+static const size_t minParallelLength = 1 << 16;
+
+// log2(d) for the small values of d, which are most of the degrees.
+static const size_t log2TableSize = 1 << 16;
+
+struct Log2Table {
+  float values[log2TableSize];
+
+  Log2Table() {
+    values[0] = 0.0f;
+    for (size_t d = 1; d < log2TableSize; ++d) {
+      values[d] = static_cast<float>(std::log2(double(d)));
+    }
+  }
+};
+
+static const Log2Table log2Table;
+
+// Estimated bits of the gaps of a list with `degree` documents in a half of
+// 2^log2Length documents.
+static inline double cost(uint32_t degree, double log2Length) {
+  const size_t d = size_t(degree) + 1;
+  return degree * (log2Length - (d < log2TableSize ? log2Table.values[d] : std::log2(double(d))));
+}
+
+GraphBisection::GraphBisection(
+  const std::vector<std::vector<uint32_t> >& lists,
+  uint32_t numDocs,
+  size_t maxIterations,
+  size_t leafSize): _numDocs(numDocs), _numTerms(static_cast<uint32_t>(lists.size())),
+    _offsets(size_t(numDocs) + 1, 0), _maxIterations(maxIterations), _leafSize(std::max(leafSize, size_t(2)))
+{
+  for (const std::vector<uint32_t>& list : lists) {
+    for (uint32_t doc : list) {
+      if (doc >= numDocs) {
+        throw std::logic_error("document identifier out of range");
+      }
+      _offsets[doc + 1]++;
+    }
+  }
+
+  for (size_t d = 0; d < numDocs; ++d) {
+    _offsets[d + 1] += _offsets[d];
+  }
+
+  _terms.resize(_offsets.back());
+
+  // _offsets[doc] is used as the next position of the lists of every
+  // document, which leaves it at the start of the next document, so they are
+  // shifted back afterwards. That saves a copy of the offsets.
+  for (uint32_t t = 0; t < _numTerms; ++t) {
+    for (uint32_t doc : lists[t]) {
+      _terms[_offsets[doc]++] = t;
+    }
+  }
+
+  for (size_t d = numDocs; d > 0; --d) {
+    _offsets[d] = _offsets[d - 1];
+  }
+  _offsets[0] = 0;
+}
+
+void GraphBisection::computeGains(
+  const uint32_t *docs,
+  size_t length,
+  size_t half,
+  Scratch& scratch,
+  float *gains,
+  size_t numThreads) const
+{
+  const double log2Left = std::log2(double(half));
+  const double log2Right = std::log2(double(length - half));
+
+  // What a list gains when one of its documents moves to the other half. It
+  // is the same for all of its documents in the same half.
+  for (uint32_t t : scratch.terms) {
+    const uint32_t left = scratch.leftDegrees[t];
+    const uint32_t right = scratch.rightDegrees[t];
+    const double current = cost(left, log2Left) + cost(right, log2Right);
+
+    scratch.leftGains[t] = static_cast<float>(left ? current - cost(left - 1, log2Left) - cost(right + 1, log2Right) : 0.0);
+    scratch.rightGains[t] = static_cast<float>(right ? current - cost(left + 1, log2Left) - cost(right - 1, log2Right) : 0.0);
+  }
+
+  // The gain of a document is how much the cost goes down when it moves to
+  // the other half.
+  auto computeRange = [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      const uint32_t doc = docs[i];
+      const std::vector<float>& termGains = (i < half) ? scratch.leftGains : scratch.rightGains;
+      float gain = 0.0f;
+
+      for (uint64_t p = _offsets[doc]; p < _offsets[doc + 1]; ++p) {
+        gain += termGains[_terms[p]];
+      }
+
+      gains[i] = gain;
+    }
+  };
+
+  if (numThreads < 2 || length < minParallelLength) {
+    computeRange(0, length);
+    return;
+  }
+
+  std::vector<std::thread> threads;
+  const size_t chunk = (length + numThreads - 1) / numThreads;
+
+  for (size_t begin = 0; begin < length; begin += chunk) {
+    threads.emplace_back(computeRange, begin, std::min(begin + chunk, length));
+  }
+
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+void GraphBisection::bisect(uint32_t *docs, size_t length, size_t numThreads, Scratch& scratch) const {
+  if (length <= _leafSize) {
+    return;
+  }
+
+  const size_t half = length / 2;
+  std::vector<uint32_t>& leftDegrees = scratch.leftDegrees;
+  std::vector<uint32_t>& rightDegrees = scratch.rightDegrees;
+
+  scratch.terms.clear();
+
+  for (size_t i = 0; i < length; ++i) {
+    std::vector<uint32_t>& degrees = (i < half) ? leftDegrees : rightDegrees;
+
+    for (uint64_t p = _offsets[docs[i]]; p < _offsets[docs[i] + 1]; ++p) {
+      const uint32_t t = _terms[p];
+
+      if (leftDegrees[t] == 0 && rightDegrees[t] == 0) {
+        scratch.terms.push_back(t);
+      }
+      degrees[t]++;
+    }
+  }
+
+  typedef std::pair<float, uint32_t> Move;
+  std::vector<float> gains(length);
+  std::vector<Move> leftMoves(half);
+  std::vector<Move> rightMoves(length - half);
+
+  for (size_t iteration = 0; iteration < _maxIterations; ++iteration) {
+    computeGains(docs, length, half, scratch, gains.data(), numThreads);
+
+    for (size_t i = 0; i < half; ++i) {
+      leftMoves[i] = Move(gains[i], docs[i]);
+    }
+    for (size_t i = half; i < length; ++i) {
+      rightMoves[i - half] = Move(gains[i], docs[i]);
+    }
+
+    // A document can only be in a swap that lowers the cost if its gain is
+    // greater than minus the best gain of the other half, so only those are
+    // sorted.
+    const float bestLeft = std::max_element(leftMoves.begin(), leftMoves.end())->first;
+    const float bestRight = std::max_element(rightMoves.begin(), rightMoves.end())->first;
+    std::vector<Move>::iterator leftEnd = std::partition(leftMoves.begin(), leftMoves.end(),
+      [bestRight](const Move& move) { return move.first > -bestRight; });
+    std::vector<Move>::iterator rightEnd = std::partition(rightMoves.begin(), rightMoves.end(),
+      [bestLeft](const Move& move) { return move.first > -bestLeft; });
+
+    std::sort(leftMoves.begin(), leftEnd, std::greater<Move>());
+    std::sort(rightMoves.begin(), rightEnd, std::greater<Move>());
+
+    // The documents that gain the most from moving are swapped in pairs, as
+    // long as a swap still lowers the cost.
+    size_t swaps = 0;
+
+    while (swaps < size_t(leftEnd - leftMoves.begin()) && swaps < size_t(rightEnd - rightMoves.begin())
+        && leftMoves[swaps].first + rightMoves[swaps].first > 0) {
+      const uint32_t leftDoc = leftMoves[swaps].second;
+      const uint32_t rightDoc = rightMoves[swaps].second;
+
+      for (uint64_t p = _offsets[leftDoc]; p < _offsets[leftDoc + 1]; ++p) {
+        leftDegrees[_terms[p]]--;
+        rightDegrees[_terms[p]]++;
+      }
+      for (uint64_t p = _offsets[rightDoc]; p < _offsets[rightDoc + 1]; ++p) {
+        rightDegrees[_terms[p]]--;
+        leftDegrees[_terms[p]]++;
+      }
+
+      std::swap(leftMoves[swaps].second, rightMoves[swaps].second);
+      swaps++;
+    }
+
+    for (size_t i = 0; i < half; ++i) {
+      docs[i] = leftMoves[i].second;
+    }
+    for (size_t i = half; i < length; ++i) {
+      docs[i] = rightMoves[i - half].second;
+    }
+
+    if (swaps == 0) {
+      break;
+    }
+  }
+
+  for (uint32_t t : scratch.terms) {
+    leftDegrees[t] = 0;
+    rightDegrees[t] = 0;
+  }
+
+  if (numThreads < 2) {
+    bisect(docs, half, 1, scratch);
+    bisect(docs + half, length - half, 1, scratch);
+    return;
+  }
+
+  const size_t leftThreads = numThreads / 2;
+  std::thread leftThread([=]() {
+    Scratch leftScratch(_numTerms);
+
+    bisect(docs, half, leftThreads, leftScratch);
+  });
+
+  bisect(docs + half, length - half, numThreads - leftThreads, scratch);
+  leftThread.join();
+}
+
+std::vector<uint32_t> GraphBisection::Order(size_t numThreads) const {
+  std::vector<uint32_t> docs;
+  Scratch scratch(_numTerms);
+
+  for (uint32_t d = 0; d < _numDocs; ++d) {
+    if (_offsets[d + 1] > _offsets[d]) {
+      docs.push_back(d);
+    }
+  }
+
+  bisect(docs.data(), docs.size(), std::max(numThreads, size_t(1)), scratch);
+
+  std::vector<uint32_t> permutation(_numDocs);
+  uint32_t next = 0;
+
+  for (uint32_t doc : docs) {
+    permutation[doc] = next++;
+  }
+
+  for (uint32_t d = 0; d < _numDocs; ++d) {
+    if (_offsets[d + 1] == _offsets[d]) {
+      permutation[d] = next++;
+    }
+  }
+
+  return permutation;
+}
+
+void RemapList(const std::vector<uint32_t>& permutation, std::vector<uint32_t>& list) {
+  for (uint32_t& value : list) {
+    value = permutation[value];
+  }
+
+  std::sort(list.begin(), list.end());
+}
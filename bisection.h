@@ -0,0 +1,69 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#ifndef INTCOMPBENCH_BISECTION_H_
+#define INTCOMPBENCH_BISECTION_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Document identifier reordering by recursive graph bisection (Dhulipala et
+// al., "Compressing Graphs and Indexes with Recursive Graph Bisection", KDD
+// 2016). The documents are split in two halves, and pairs of documents are
+// swapped between them for as long as that lowers an estimate of the cost of
+// encoding the gaps of the lists: for a list with d documents in a half of n
+// documents, d * log2(n / (d + 1)) bits. Both halves are then split again,
+// down to `leafSize` documents. The halves are split in parallel, and the
+// move gains of the largest ones are computed in parallel too.
+class GraphBisection {
+private:
+  // Per-list state of a bisection, kept by every thread.
+  struct Scratch {
+    std::vector<uint32_t> leftDegrees;
+    std::vector<uint32_t> rightDegrees;
+    std::vector<float> leftGains;
+    std::vector<float> rightGains;
+    // The lists with documents in the halves being split.
+    std::vector<uint32_t> terms;
+
+    explicit Scratch(size_t numTerms)
+      : leftDegrees(numTerms, 0), rightDegrees(numTerms, 0), leftGains(numTerms), rightGains(numTerms) {}
+  };
+
+  uint32_t _numDocs;
+  uint32_t _numTerms;
+  // Forward index: the lists of every document.
+  std::vector<uint64_t> _offsets;
+  std::vector<uint32_t> _terms;
+  size_t _maxIterations;
+  size_t _leafSize;
+
+  void computeGains(
+    const uint32_t *docs,
+    size_t length,
+    size_t half,
+    Scratch& scratch,
+    float *gains,
+    size_t numThreads) const;
+  void bisect(uint32_t *docs, size_t length, size_t numThreads, Scratch& scratch) const;
+
+public:
+  // `lists` are the sorted lists of document identifiers, all of them lower
+  // than `numDocs`.
+  GraphBisection(
+    const std::vector<std::vector<uint32_t> >& lists,
+    uint32_t numDocs,
+    size_t maxIterations = 20,
+    size_t leafSize = 16);
+
+  // Returns the new identifier of every document. The documents that are in
+  // none of the lists go last, in their original order.
+  std::vector<uint32_t> Order(size_t numThreads) const;
+};
+
+// Maps every integer of `list` through `permutation` and sorts the result.
+void RemapList(const std::vector<uint32_t>& permutation, std::vector<uint32_t>& list);
+
+#endif // INTCOMPBENCH_BISECTION_H_
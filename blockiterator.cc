@@ -0,0 +1,268 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#include "blockiterator.h"
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "common.h"
+
+// Room past the end of the block buffer, for the codecs that write a little
+// beyond the integers they decode.
+static const size_t bufferPadding = 256;
+
+BlockEncodedList::BlockEncodedList(
+  SIMDCompressionLib::IntegerCODEC& codec,
+  size_t blockSize,
+  size_t blockLength,
+  const std::vector<uint32_t>& data): _codec(codec), _blockSize(blockSize), _blockLength(blockLength),
+    _length(data.size())
+{
+  if (blockLength == 0 || blockLength % blockSize != 0) {
+    throw std::logic_error("the block length must be a multiple of the codec block size");
+  }
+
+  // The delta codecs overwrite their input, so every block is copied first.
+  std::vector<uint32_t> values(blockLength);
+  std::vector<uint32_t> out(blockLength + blockLength / 4 + 1024);
+
+  _offsets.push_back(0);
+
+  for (size_t begin = 0; begin < _length; begin += blockLength) {
+    const size_t length = std::min(blockLength, _length - begin);
+
+    std::copy(data.begin() + begin, data.begin() + begin + length, values.begin());
+    const size_t encodedLength = EncodeWithFallback(
+      _codec, _fallbackCodec, _blockSize, values.data(), length, out.data(), out.size());
+
+    _encoded.insert(_encoded.end(), out.begin(), out.begin() + encodedLength);
+    _offsets.push_back(_encoded.size());
+  }
+}
+
+size_t BlockEncodedList::DecodeBlock(size_t block, uint32_t *out) {
+  const size_t length = std::min(_blockLength, _length - block * _blockLength);
+
+  DecodeWithFallback(_codec, _fallbackCodec, _blockSize, _encoded.data() + _offsets[block],
+    _offsets[block + 1] - _offsets[block], out, length);
+
+  return length;
+}
+
+size_t BlockEncodedList::Length() const {
+  return _length;
+}
+
+size_t BlockEncodedList::BlockLength() const {
+  return _blockLength;
+}
+
+size_t BlockEncodedList::NumBlocks() const {
+  return _offsets.size() - 1;
+}
+
+size_t BlockEncodedList::EncodedLengthInBytes() const {
+  return (_encoded.size() + NumBlocks()) * sizeof(uint32_t);
+}
+
+BlockIterator::BlockIterator(BlockEncodedList& list): _list(list),
+  _buffer(list.BlockLength() + bufferPadding), _nextBlock(0), _position(0), _length(0)
+{
+}
+
+size_t BlockIterator::Next() {
+  _position += _length;
+
+  if (_nextBlock == _list.NumBlocks()) {
+    _length = 0;
+    return 0;
+  }
+
+  _length = _list.DecodeBlock(_nextBlock++, _buffer.data());
+  return _length;
+}
+
+const uint32_t *BlockIterator::Data() const {
+  return _buffer.data();
+}
+
+size_t BlockIterator::Position() const {
+  return _position;
+}
+
+void BlockIterator::Rewind() {
+  _nextBlock = 0;
+  _position = 0;
+  _length = 0;
+}
+
+const char *FusedConsumerName(FusedConsumer consumer) {
+  switch (consumer) {
+    case FUSED_SUM: return "sum";
+    case FUSED_COUNT_IN_RANGE: return "count";
+    case FUSED_FILTER_BITMAP: return "bitmap";
+  }
+  return "unknown";
+}
+
+// Values in [low, low + width), tested with a single unsigned comparison.
+struct ScanRange {
+  uint32_t low;
+  uint32_t width;
+};
+
+static ScanRange middleHalfOf(const std::vector<uint32_t>& list) {
+  ScanRange range = {0, 0};
+
+  if (!list.empty()) {
+    const auto minMax = std::minmax_element(list.begin(), list.end());
+    const uint64_t span = uint64_t(*minMax.second) - uint64_t(*minMax.first);
+
+    range.low = static_cast<uint32_t>(*minMax.first + span / 4);
+    range.width = static_cast<uint32_t>(span / 2);
+  }
+
+  return range;
+}
+
+static inline uint64_t sumOf(const uint32_t *in, size_t length) {
+  uint64_t sum = 0;
+
+  for (size_t i = 0; i < length; ++i) {
+    sum += in[i];
+  }
+
+  return sum;
+}
+
+static inline uint64_t countInRange(const uint32_t *in, size_t length, ScanRange range) {
+  uint64_t count = 0;
+
+  for (size_t i = 0; i < length; ++i) {
+    count += (in[i] - range.low) < range.width;
+  }
+
+  return count;
+}
+
+// `bitmap` holds the bit of in[0] in its first bit, so `in` must start at a
+// position of the list that is a multiple of 64.
+static inline uint64_t filterToBitmap(const uint32_t *in, size_t length, ScanRange range, uint64_t *bitmap) {
+  for (size_t i = 0; i < length; i += 64) {
+    const size_t wordLength = std::min(length - i, size_t(64));
+    uint64_t word = 0;
+
+    for (size_t j = 0; j < wordLength; ++j) {
+      word |= uint64_t((in[i + j] - range.low) < range.width) << j;
+    }
+
+    bitmap[i / 64] = word;
+  }
+
+  return 0;
+}
+
+static inline uint64_t consume(
+  FusedConsumer consumer,
+  const uint32_t *in,
+  size_t length,
+  ScanRange range,
+  uint64_t *bitmap)
+{
+  switch (consumer) {
+    case FUSED_SUM: return sumOf(in, length);
+    case FUSED_COUNT_IN_RANGE: return countInRange(in, length, range);
+    case FUSED_FILTER_BITMAP: return filterToBitmap(in, length, range, bitmap);
+  }
+  return 0;
+}
+
+void BenchmarkFusedScan(
+  SIMDCompressionLib::IntegerCODEC& codec,
+  size_t blockSize,
+  std::vector<std::vector<uint32_t> >& lists,
+  FusedConsumer consumer,
+  size_t blockLength,
+  benchmark::State& state)
+{
+  if (blockLength % 64 != 0 || (blockLength > 0 && blockLength % blockSize != 0)) {
+    state.SkipWithError("block length not a multiple of 64 or of the codec block size");
+    return;
+  }
+
+  const bool bitmapConsumer = (consumer == FUSED_FILTER_BITMAP);
+  std::vector<ScanRange> ranges;
+  std::vector<std::vector<uint64_t> > bitmaps(lists.size()), expectedBitmaps(lists.size());
+  uint64_t expected = 0, result = 0;
+  size_t inputLength = 0, encodedLengthInBytes = 0;
+
+  for (size_t i = 0; i < lists.size(); ++i) {
+    if (bitmapConsumer) {
+      bitmaps[i].resize((lists[i].size() + 63) / 64);
+      expectedBitmaps[i].resize(bitmaps[i].size());
+    }
+    ranges.push_back(middleHalfOf(lists[i]));
+    expected += consume(consumer, lists[i].data(), lists[i].size(), ranges[i], expectedBitmaps[i].data());
+    inputLength += lists[i].size();
+  }
+
+  std::vector<std::unique_ptr<SIMDCompressionUtil> > comps;
+  std::vector<std::unique_ptr<BlockEncodedList> > blockLists;
+  std::vector<std::unique_ptr<BlockIterator> > iterators;
+
+  for (std::vector<uint32_t>& list : lists) {
+    if (blockLength == 0) {
+      comps.emplace_back(new SIMDCompressionUtil(codec, blockSize, list));
+      comps.back()->Encode();
+      encodedLengthInBytes += comps.back()->EncodedLength() * sizeof(uint32_t);
+    } else {
+      blockLists.emplace_back(new BlockEncodedList(codec, blockSize, blockLength, list));
+      iterators.emplace_back(new BlockIterator(*blockLists.back()));
+      encodedLengthInBytes += blockLists.back()->EncodedLengthInBytes();
+    }
+  }
+
+  CompressionStats stats(state);
+
+  if (blockLength == 0) {
+    for (auto _ : state) {
+      result = 0;
+      for (size_t i = 0; i < comps.size(); ++i) {
+        comps[i]->Decode();
+        result += consume(consumer, comps[i]->DecodedData(), lists[i].size(), ranges[i], bitmaps[i].data());
+      }
+      benchmark::DoNotOptimize(result);
+      benchmark::ClobberMemory();
+    }
+  } else {
+    for (auto _ : state) {
+      result = 0;
+      for (size_t i = 0; i < iterators.size(); ++i) {
+        BlockIterator& iterator = *iterators[i];
+        size_t length;
+
+        iterator.Rewind();
+        while ((length = iterator.Next()) > 0) {
+          uint64_t *bitmap = bitmapConsumer ? bitmaps[i].data() + iterator.Position() / 64 : NULL;
+          result += consume(consumer, iterator.Data(), length, ranges[i], bitmap);
+        }
+      }
+      benchmark::DoNotOptimize(result);
+      benchmark::ClobberMemory();
+    }
+  }
+
+  stats.SetInputLengthInBytes(inputLength * sizeof(uint32_t));
+  stats.SetEncodedLengthInBytes(encodedLengthInBytes);
+  stats.SetFinalStats();
+  state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(inputLength));
+  state.SetLabel(FusedConsumerName(consumer));
+
+  if (result != expected || bitmaps != expectedBitmaps) {
+    throw std::logic_error("equality check failed");
+  }
+}
@@ -0,0 +1,101 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#ifndef INTCOMPBENCH_BLOCKITERATOR_H_
+#define INTCOMPBENCH_BLOCKITERATOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "benchmark/include/benchmark/benchmark.h"
+#include "SIMDCompressionAndIntersection/include/codecs.h"
+#include "SIMDCompressionAndIntersection/include/variablebyte.h"
+
+// A list split into blocks of `blockLength` integers, each one encoded on its
+// own as SIMDCompressionUtil does, so that they can be decoded one at a time.
+// `blockLength` must be a multiple of the block size of the codec.
+class BlockEncodedList {
+private:
+  SIMDCompressionLib::VByte<true> _fallbackCodec;
+  SIMDCompressionLib::IntegerCODEC& _codec;
+  size_t _blockSize;
+  size_t _blockLength;
+  size_t _length;
+  std::vector<uint32_t> _encoded;
+  // Offset in _encoded of every block, and the end of the last one.
+  std::vector<size_t> _offsets;
+
+  BlockEncodedList(const BlockEncodedList&);
+  BlockEncodedList& operator=(const BlockEncodedList&);
+
+public:
+  BlockEncodedList(
+    SIMDCompressionLib::IntegerCODEC& codec,
+    size_t blockSize,
+    size_t blockLength,
+    const std::vector<uint32_t>& data);
+
+  // Decodes the given block to `out` and returns its length.
+  size_t DecodeBlock(size_t block, uint32_t *out);
+  size_t Length() const;
+  size_t BlockLength() const;
+  size_t NumBlocks() const;
+  // The encoded blocks and their offsets, one word per block.
+  size_t EncodedLengthInBytes() const;
+};
+
+// Pull-based decoder of a BlockEncodedList: every call to Next() decodes the
+// following block into a buffer of one block, small enough to stay in L1,
+// instead of decoding the whole list to memory.
+class BlockIterator {
+private:
+  BlockEncodedList& _list;
+  std::vector<uint32_t> _buffer;
+  size_t _nextBlock;
+  size_t _position;
+  size_t _length;
+
+public:
+  explicit BlockIterator(BlockEncodedList& list);
+
+  // Decodes the next block and returns its length, or 0 after the last one.
+  size_t Next();
+  // The integers of the last decoded block.
+  const uint32_t *Data() const;
+  // Position in the list of the first integer of the last decoded block.
+  size_t Position() const;
+  // Goes back to the first block.
+  void Rewind();
+};
+
+// What is done with the decoded integers.
+enum FusedConsumer {
+  // Adds them up.
+  FUSED_SUM,
+  // Counts those in the middle half of the range of values of the list.
+  FUSED_COUNT_IN_RANGE,
+  // Sets, in a bitmap of positions, the bits of those in the middle half of
+  // the range of values of the list.
+  FUSED_FILTER_BITMAP
+};
+
+// Returns the name of the consumer: "sum", "count" or "bitmap".
+const char *FusedConsumerName(FusedConsumer consumer);
+
+// Decodes `lists` and feeds their integers to `consumer`. With a
+// `blockLength` of 0, every list is decoded in full, as SIMDCompressionUtil
+// does, and then scanned; otherwise, the lists are encoded in blocks of
+// `blockLength` integers and every block is consumed as soon as it is
+// decoded by a BlockIterator. The results are checked against those of the
+// original lists.
+void BenchmarkFusedScan(
+  SIMDCompressionLib::IntegerCODEC& codec,
+  size_t blockSize,
+  std::vector<std::vector<uint32_t> >& lists,
+  FusedConsumer consumer,
+  size_t blockLength,
+  benchmark::State& state);
+
+#endif // INTCOMPBENCH_BLOCKITERATOR_H_
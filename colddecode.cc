@@ -0,0 +1,213 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#include "colddecode.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Words in a cache line. Every copy starts on its own line.
+static const size_t lineWords = 64 / sizeof(uint32_t);
+
+static size_t roundUpToLine(size_t words) {
+  return (words + lineWords - 1) / lineWords * lineWords;
+}
+
+const char *CacheLevelName(CacheLevel level) {
+  switch (level) {
+    case CACHE_L1: return "L1";
+    case CACHE_L2: return "L2";
+    case CACHE_L3: return "L3";
+    case CACHE_DRAM: return "DRAM";
+  }
+
+  throw std::logic_error("unknown cache level");
+}
+
+// Parses sizes like "48K" or "32M", as found in sysfs.
+static size_t parseCacheSize(const std::string& text) {
+  char *end = NULL;
+  size_t size = std::strtoul(text.c_str(), &end, 10);
+
+  if (*end == 'K') {
+    size <<= 10;
+  } else if (*end == 'M') {
+    size <<= 20;
+  }
+
+  return size;
+}
+
+static size_t sysfsCacheSize(int level) {
+  for (int index = 0; ; ++index) {
+    const std::string dir = "/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(index) + "/";
+    std::ifstream levelFile(dir + "level");
+    std::ifstream typeFile(dir + "type");
+    std::ifstream sizeFile(dir + "size");
+    int cacheLevel;
+    std::string type, size;
+
+    if (!(levelFile >> cacheLevel) || !(typeFile >> type) || !(sizeFile >> size)) {
+      return 0;
+    }
+
+    if (cacheLevel == level && type != "Instruction") {
+      return parseCacheSize(size);
+    }
+  }
+}
+
+size_t CacheSizeInBytes(CacheLevel level) {
+  static const int sysconfNames[] = {
+    _SC_LEVEL1_DCACHE_SIZE, _SC_LEVEL2_CACHE_SIZE, _SC_LEVEL3_CACHE_SIZE
+  };
+  static const size_t defaultSizes[] = {
+    size_t(32) << 10, size_t(1) << 20, size_t(32) << 20
+  };
+
+  if (level == CACHE_DRAM) {
+    throw std::logic_error("DRAM is not a cache");
+  }
+
+  size_t size = sysfsCacheSize(level + 1);
+
+  if (size == 0) {
+    const long value = sysconf(sysconfNames[level]);
+    size = (value > 0) ? size_t(value) : defaultSizes[level];
+  }
+
+  return size;
+}
+
+size_t WorkingSetBytes(CacheLevel level) {
+  if (level == CACHE_DRAM) {
+    return std::max(4 * CacheSizeInBytes(CACHE_L3), size_t(256) << 20);
+  }
+
+  return CacheSizeInBytes(level) / 2;
+}
+
+RotatingDecoder::RotatingDecoder(
+  SIMDCompressionLib::IntegerCODEC& codec,
+  size_t blockSize,
+  std::vector<uint32_t>& data,
+  size_t workingSetBytes): _codec(codec), _blockSize(blockSize), _inputLength(data.size()), _next(0)
+{
+  HugePageVector<uint32_t> copyOfData(data.begin(), data.end());
+  HugePageVector<uint32_t> encoded(_inputLength + 1024);
+
+  _encodedLength = EncodeWithFallback(_codec, _fallbackCodec, _blockSize,
+    copyOfData.data(), _inputLength, encoded.data(), encoded.size());
+
+  // A spare line after every output buffer, in case a codec writes a few
+  // integers past the end.
+  _encodedStride = roundUpToLine(_encodedLength);
+  _decodedStride = DecodedFootprintInBytes(_inputLength) / sizeof(uint32_t);
+  _numCopies = std::max(workingSetBytes / CopyFootprintInBytes(), size_t(1));
+
+  _encoded.resize(_numCopies * _encodedStride);
+  _decoded.resize(_numCopies * _decodedStride);
+  _order.resize(_numCopies);
+
+  for (size_t c = 0; c < _numCopies; ++c) {
+    std::copy(encoded.begin(), encoded.begin() + _encodedLength, _encoded.begin() + c * _encodedStride);
+    _order[c] = static_cast<uint32_t>(c);
+  }
+
+  std::mt19937 generator(1234);
+  std::shuffle(_order.begin(), _order.end(), generator);
+}
+
+void RotatingDecoder::DecodeNext() {
+  const size_t copy = _order[_next];
+
+  DecodeWithFallback(_codec, _fallbackCodec, _blockSize,
+    _encoded.data() + copy * _encodedStride, _encodedLength,
+    _decoded.data() + copy * _decodedStride, _inputLength);
+
+  if (++_next == _numCopies) {
+    _next = 0;
+  }
+}
+
+size_t RotatingDecoder::NumCopies() const {
+  return _numCopies;
+}
+
+size_t RotatingDecoder::InputLength() const {
+  return _inputLength;
+}
+
+size_t RotatingDecoder::EncodedLength() const {
+  return _encodedLength;
+}
+
+size_t RotatingDecoder::CopyFootprintInBytes() const {
+  return (_encodedStride + _decodedStride) * sizeof(uint32_t);
+}
+
+size_t RotatingDecoder::DecodedFootprintInBytes(size_t inputLength) {
+  return (roundUpToLine(inputLength) + lineWords) * sizeof(uint32_t);
+}
+
+void RotatingDecoder::EqualityCheck(const std::vector<uint32_t>& data) const {
+  for (size_t c = 0; c < _numCopies; ++c) {
+    const uint32_t *decoded = _decoded.data() + c * _decodedStride;
+
+    if (data.size() != _inputLength || !std::equal(data.begin(), data.end(), decoded)) {
+      throw std::logic_error("equality check failed");
+    }
+  }
+}
+
+void BenchmarkRotatingDecode(
+  SIMDCompressionLib::IntegerCODEC& codec,
+  size_t blockSize,
+  std::vector<uint32_t>& data,
+  CacheLevel level,
+  benchmark::State& state)
+{
+  const size_t workingSetBytes = WorkingSetBytes(level);
+  // A list larger than the DRAM working set is out of every cache anyway.
+  const bool singleCopyAllowed = (level == CACHE_DRAM);
+
+  // Checked before encoding, so that a list far too large for the level
+  // costs neither the encoding nor the buffers.
+  if (!singleCopyAllowed && RotatingDecoder::DecodedFootprintInBytes(data.size()) > workingSetBytes) {
+    state.SkipWithError("list larger than the working set");
+    return;
+  }
+
+  RotatingDecoder decoder(codec, blockSize, data, workingSetBytes);
+
+  if (!singleCopyAllowed && decoder.CopyFootprintInBytes() > workingSetBytes) {
+    state.SkipWithError("list larger than the working set");
+    return;
+  }
+
+  for (size_t c = 0; c < decoder.NumCopies(); ++c) {
+    decoder.DecodeNext();
+  }
+  decoder.EqualityCheck(data);
+
+  CompressionStats stats(state);
+
+  for (auto _ : state) {
+    decoder.DecodeNext();
+  }
+
+  stats.SetInputLengthInBytes(decoder.InputLength() * sizeof(uint32_t));
+  stats.SetEncodedLengthInBytes(decoder.EncodedLength() * sizeof(uint32_t));
+  stats.SetFinalStats();
+  state.SetLabel(CacheLevelName(level));
+  state.counters["workingSet"] = decoder.NumCopies() * decoder.CopyFootprintInBytes();
+  state.counters["copies"] = decoder.NumCopies();
+}
@@ -0,0 +1,96 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#ifndef INTCOMPBENCH_COLDDECODE_H_
+#define INTCOMPBENCH_COLDDECODE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "common.h"
+
+#include "benchmark/include/benchmark/benchmark.h"
+#include "SIMDCompressionAndIntersection/include/codecs.h"
+#include "SIMDCompressionAndIntersection/include/variablebyte.h"
+
+// Level of the memory hierarchy that the working set of a benchmark fits in.
+enum CacheLevel {
+  CACHE_L1,
+  CACHE_L2,
+  CACHE_L3,
+  CACHE_DRAM
+};
+
+// Returns the name of the level: "L1", "L2", "L3" or "DRAM".
+const char *CacheLevelName(CacheLevel level);
+
+// Returns the size in bytes of the given data or unified cache of the first
+// CPU, as reported by sysfs or, failing that, by sysconf(). Returns a usual
+// size when neither of them knows it.
+size_t CacheSizeInBytes(CacheLevel level);
+
+// Returns the size of a working set that fits in the given level: half of the
+// cache, so that the stack and the benchmark library do not evict it, or, for
+// CACHE_DRAM, four times the last-level cache and at least 256 MiB.
+size_t WorkingSetBytes(CacheLevel level);
+
+// Many copies of an encoded list, each one with its own output buffer, that
+// are decoded one after the other in a fixed random order. The number of
+// copies is chosen so that the encoded and the decoded buffers of all of them
+// add up to the requested working set; when it is larger than the cache, a
+// copy has been evicted by the time it is decoded again, and the random order
+// keeps the hardware prefetchers from guessing the next one. The list is
+// encoded as SIMDCompressionUtil does.
+class RotatingDecoder {
+private:
+  SIMDCompressionLib::VByte<true> _fallbackCodec;
+  SIMDCompressionLib::IntegerCODEC& _codec;
+  size_t _blockSize;
+  size_t _inputLength;
+  size_t _encodedLength;
+  size_t _encodedStride;
+  size_t _decodedStride;
+  size_t _numCopies;
+  HugePageVector<uint32_t> _encoded;
+  HugePageVector<uint32_t> _decoded;
+  std::vector<uint32_t> _order;
+  size_t _next;
+
+  RotatingDecoder(const RotatingDecoder&);
+  RotatingDecoder& operator=(const RotatingDecoder&);
+
+public:
+  RotatingDecoder(
+    SIMDCompressionLib::IntegerCODEC& codec,
+    size_t blockSize,
+    std::vector<uint32_t>& data,
+    size_t workingSetBytes);
+
+  // Decodes the next copy.
+  void DecodeNext();
+  size_t NumCopies() const;
+  size_t InputLength() const;
+  size_t EncodedLength() const;
+  // Bytes of the encoded and decoded buffers of one copy.
+  size_t CopyFootprintInBytes() const;
+  // Bytes of the decoded buffer of one copy of a list of the given length: a
+  // lower bound of CopyFootprintInBytes() that is known before encoding.
+  static size_t DecodedFootprintInBytes(size_t inputLength);
+  // Checks that every copy was decoded to `data`.
+  void EqualityCheck(const std::vector<uint32_t>& data) const;
+};
+
+// Decodes `data` from a RotatingDecoder whose working set fits in `level`.
+// Every copy is decoded and checked once before measuring. Skips the
+// benchmark when a single copy does not fit in the working set, except at
+// CACHE_DRAM, where such a list is decoded from a single copy.
+void BenchmarkRotatingDecode(
+  SIMDCompressionLib::IntegerCODEC& codec,
+  size_t blockSize,
+  std::vector<uint32_t>& data,
+  CacheLevel level,
+  benchmark::State& state);
+
+#endif // INTCOMPBENCH_COLDDECODE_H_
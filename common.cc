@@ -3,19 +3,91 @@
 // See LICENSE file in the project root for full license information.
 
 #include "common.h"
+#include "timeseries.h"
+#include "vtenccodec.h"
+
+#include <sys/mman.h>
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
 #include "benchmark/include/benchmark/benchmark.h"
+#include "SIMDCompressionAndIntersection/include/binarypacking.h"
+#include "SIMDCompressionAndIntersection/include/codecfactory.h"
 #include "SIMDCompressionAndIntersection/include/codecs.h"
+#include "SIMDCompressionAndIntersection/include/fastpfor.h"
 #include "SIMDCompressionAndIntersection/include/variablebyte.h"
+#include "SIMDCompressionAndIntersection/include/varintgb.h"
 
 std::string GlobalState::dataDirectory = std::string();
+std::string GlobalState::scratchDirectory = std::string();
+std::string GlobalState::gov2File = std::string("gov2.sorted");
+double GlobalState::gov2SampleFraction = 0.0;
+HugePagesMode GlobalState::hugePages = HUGE_PAGES_OFF;
+
+static const size_t hugePageSize = size_t(2) << 20;
+
+static size_t roundUpToHugePage(size_t bytes) {
+  return (bytes + hugePageSize - 1) & ~(hugePageSize - 1);
+}
+
+void *AllocateBuffer(size_t bytes, HugePagesMode mode) {
+  void *ptr = NULL;
+
+  if (mode == HUGE_PAGES_OFF || bytes < hugePageSize) {
+    return ::operator new(bytes);
+  }
+
+  if (mode == HUGE_PAGES_THP) {
+    if (posix_memalign(&ptr, hugePageSize, roundUpToHugePage(bytes)) != 0) {
+      throw std::bad_alloc();
+    }
+    madvise(ptr, roundUpToHugePage(bytes), MADV_HUGEPAGE);
+    return ptr;
+  }
+
+  ptr = mmap(NULL, roundUpToHugePage(bytes), PROT_READ | PROT_WRITE,
+    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (ptr == MAP_FAILED) {
+    throw std::runtime_error("Failed to allocate hugetlb pages, check /proc/sys/vm/nr_hugepages");
+  }
+  return ptr;
+}
+
+void FreeBuffer(void *ptr, size_t bytes, HugePagesMode mode) {
+  if (mode == HUGE_PAGES_OFF || bytes < hugePageSize) {
+    ::operator delete(ptr);
+  } else if (mode == HUGE_PAGES_THP) {
+    free(ptr);
+  } else {
+    munmap(ptr, roundUpToHugePage(bytes));
+  }
+}
 
 CompressionStats::CompressionStats(benchmark::State& state): _state(state) {
   Reset();
+  _energyMeter.Start();
+  _tlbCounters.Start();
+}
+
+void CompressionStats::PauseTiming() {
+  _state.PauseTiming();
+  _tlbCounters.Pause();
+  _energyMeter.Pause();
+}
+
+void CompressionStats::ResumeTiming() {
+  _energyMeter.Resume();
+  _tlbCounters.Resume();
+  _state.ResumeTiming();
 }
 
 void CompressionStats::SetInputLengthInBytes(size_t len) {
@@ -45,6 +117,17 @@ void CompressionStats::ResetEncodedLengthInBytes() {
 void CompressionStats::SetFinalStats() {
   _state.counters["compressionRatio"] = _state.counters["inputLength"] / _state.counters["encodedLength"];
   _state.SetBytesProcessed(int64_t(_state.iterations()) * int64_t(_state.counters["inputLength"]));
+
+  if (_tlbCounters.Available()) {
+    uint64_t accesses, misses;
+    _tlbCounters.Stop(accesses, misses);
+    _state.counters["dTLBMissRate"] = (accesses > 0) ? (double(misses) / double(accesses)) : 0;
+  }
+
+  if (EnergyMeter::Available()) {
+    double gigabytes = double(_state.iterations()) * _state.counters["inputLength"] / 1e9;
+    _state.counters["joulesPerGB"] = _energyMeter.ElapsedJoules() / gigabytes;
+  }
 }
 
 void CompressionStats::Reset() {
@@ -55,14 +138,26 @@ void CompressionStats::Reset() {
 SIMDCompressionUtil::SIMDCompressionUtil(
   SIMDCompressionLib::IntegerCODEC& codec,
   size_t blockSize,
-  std::vector<uint32_t>& data): _codec(codec), _data(data)
+  std::vector<uint32_t>& data): SIMDCompressionUtil(codec, blockSize, data, _defaultFallbackCodec, 0)
+{
+}
+
+SIMDCompressionUtil::SIMDCompressionUtil(
+  SIMDCompressionLib::IntegerCODEC& codec,
+  size_t blockSize,
+  std::vector<uint32_t>& data,
+  SIMDCompressionLib::IntegerCODEC& fallbackCodec,
+  size_t smallListThreshold): _codec(codec), _fallbackCodec(fallbackCodec), _data(data)
 {
   _inputLength = data.size();
-  _inputLength2 = _inputLength % blockSize;
+  _smallList = _inputLength < smallListThreshold;
+  _inputLength2 = _smallList ? _inputLength : (_inputLength % blockSize);
   _inputLength1 = _inputLength - _inputLength2;
   _copyOfData.resize(_inputLength);
-  _encoded.resize(_inputLength + 1024);
-  _encodedLength1 = _encoded.size();
+  // Without delta coding, VByte and VarIntGB can take more than a word per
+  // integer.
+  _encoded.resize(_inputLength + _inputLength / 4 + 1024);
+  _encodedLength1 = _smallList ? 0 : _encoded.size();
   _encodedLength2 = _encoded.size();
   _decoded.resize(_inputLength);
 
@@ -74,16 +169,40 @@ void SIMDCompressionUtil::Reset(){
 }
 
 void SIMDCompressionUtil::Encode() {
-  _codec.encodeArray(_copyOfData.data(), _inputLength1, _encoded.data(), _encodedLength1);
+  EncodeBlocks();
+  EncodeTail();
+}
+
+void SIMDCompressionUtil::EncodeBlocks() {
+  if (!_smallList) {
+    _encodedLength1 = _encoded.size();
+    _codec.encodeArray(_copyOfData.data(), _inputLength1, _encoded.data(), _encodedLength1);
+  }
+}
+
+void SIMDCompressionUtil::EncodeTail() {
   if (_inputLength2) {
+    _encodedLength2 = _encoded.size() - _encodedLength1;
     _fallbackCodec.encodeArray(_copyOfData.data() + _inputLength1, _inputLength2, _encoded.data() + _encodedLength1, _encodedLength2);
   }
 }
 
 void SIMDCompressionUtil::Decode() {
-  _codec.decodeArray(_encoded.data(), _encodedLength1, _decoded.data(), _inputLength1);
+  DecodeBlocks();
+  DecodeTail();
+}
+
+void SIMDCompressionUtil::DecodeBlocks() {
+  if (!_smallList) {
+    size_t decodedLength = _inputLength1;
+    _codec.decodeArray(_encoded.data(), _encodedLength1, _decoded.data(), decodedLength);
+  }
+}
+
+void SIMDCompressionUtil::DecodeTail() {
   if (_inputLength2) {
-    _fallbackCodec.decodeArray(_encoded.data() + _encodedLength1, _encodedLength2, _decoded.data() + _inputLength1, _inputLength2);
+    size_t decodedLength = _inputLength2;
+    _fallbackCodec.decodeArray(_encoded.data() + _encodedLength1, _encodedLength2, _decoded.data() + _inputLength1, decodedLength);
   }
 }
 
@@ -95,8 +214,400 @@ size_t SIMDCompressionUtil::EncodedLength() {
   return (_inputLength2) ? (_encodedLength1 + _encodedLength2) : _encodedLength1;
 }
 
+size_t SIMDCompressionUtil::TailInputLength() {
+  return _inputLength2;
+}
+
+size_t SIMDCompressionUtil::TailEncodedLength() {
+  return (_inputLength2) ? _encodedLength2 : 0;
+}
+
 void SIMDCompressionUtil::EqualityCheck() {
-  if (_data != _decoded) {
+  if (_data.size() != _decoded.size() || !std::equal(_data.begin(), _data.end(), _decoded.begin())) {
     throw std::logic_error("equality check failed");
   }
 }
+
+const uint32_t *SIMDCompressionUtil::DecodedData() const {
+  return _decoded.data();
+}
+
+void Gov2SortedFile::Open(const std::string& fileName) {
+  _inFile.open(fileName, std::ios::in | std::ios::binary);
+
+  if (_inFile.fail()) {
+    throw std::logic_error("Failed to open '" + fileName + "'");
+  }
+
+  _bufferCount = 0;
+  _bufferOffset = 0;
+}
+
+void Gov2SortedFile::Close() {
+  _inFile.close();
+}
+
+void Gov2SortedFile::refreshBuffer() {
+  // Here, it is assumed that the file has a size multiple of 4, so there is no
+  // left bytes to copy over when refreshing the buffer.
+  _inFile.read(_buffer, sizeof(_buffer));
+  _bufferCount = _inFile.gcount();
+  _bufferOffset = 0;
+  if (_bufferCount == 0) {
+    throw "End of file";
+  }
+}
+
+uint32_t Gov2SortedFile::readNextUint32() {
+  if ((_bufferCount - _bufferOffset) < 4) {
+    refreshBuffer();
+  }
+  uint32_t value;
+  std::memcpy(&value, &(_buffer[_bufferOffset]), sizeof(value));
+  _bufferOffset += 4;
+  return value;
+}
+
+bool Gov2SortedFile::LoadNextSet(std::vector<uint32_t>& data) {
+  data.clear();
+
+  try {
+    uint32_t len = readNextUint32();
+    for (size_t i = 0; i < len; ++i) {
+      data.push_back(readNextUint32());
+    }
+  } catch (...) {
+    return false;
+  }
+
+  return true;
+}
+
+std::string Gov2SortedPath() {
+  return GlobalState::dataDirectory + "/" + GlobalState::gov2File;
+}
+
+void LoadGov2SortedSets(
+  std::vector<std::vector<uint32_t> >& sets,
+  size_t minLength,
+  size_t maxLength)
+{
+  Gov2SortedFile file;
+  std::vector<uint32_t> data;
+
+  file.Open(Gov2SortedPath());
+
+  while (file.LoadNextSet(data)) {
+    if (data.size() >= minLength && data.size() < maxLength) {
+      sets.push_back(data);
+    }
+  }
+
+  file.Close();
+}
+
+void SampleGov2SortedSets(
+  std::vector<std::vector<uint32_t> >& sets,
+  size_t minLength,
+  size_t maxLength,
+  size_t sampleSize,
+  uint64_t seed)
+{
+  Gov2SortedFile file;
+  std::vector<uint32_t> data;
+  std::mt19937_64 generator(seed);
+  size_t seen = 0;
+
+  file.Open(Gov2SortedPath());
+
+  while (file.LoadNextSet(data)) {
+    if (data.size() < minLength || data.size() >= maxLength) {
+      continue;
+    }
+
+    if (sets.size() < sampleSize) {
+      sets.push_back(data);
+    } else {
+      std::uniform_int_distribution<size_t> position(0, seen);
+      size_t p = position(generator);
+      if (p < sampleSize) {
+        sets[p] = data;
+      }
+    }
+
+    seen++;
+  }
+
+  file.Close();
+}
+
+template <class Codec>
+static CodecDescriptor makeCodec(const std::string& name, size_t blockSize) {
+  CodecDescriptor desc;
+  desc.name = name;
+  desc.blockSize = blockSize;
+  desc.create = []() {
+    return std::shared_ptr<SIMDCompressionLib::IntegerCODEC>(new Codec());
+  };
+  return desc;
+}
+
+// Codecs taken from SIMDCompressionLib::CODECFactory are composite codecs
+// that already handle lengths that are not a multiple of their block size.
+static CodecDescriptor makeFactoryCodec(const std::string& name, const std::string& factoryName) {
+  CodecDescriptor desc;
+  desc.name = name;
+  desc.blockSize = 1;
+  desc.create = [factoryName]() {
+    SIMDCompressionLib::CODECFactory factory;
+    std::vector<std::string> names = factory.allNames();
+
+    if (std::find(names.begin(), names.end(), factoryName) == names.end()) {
+      return std::shared_ptr<SIMDCompressionLib::IntegerCODEC>();
+    }
+
+    return std::shared_ptr<SIMDCompressionLib::IntegerCODEC>(factory.getFromName(factoryName));
+  };
+  return desc;
+}
+
+static std::vector<CodecDescriptor> makeCodecTable() {
+  typedef SIMDCompressionLib::BinaryPacking<SIMDCompressionLib::BasicBlockPacker> DeltaBinaryPacking;
+  typedef SIMDCompressionLib::FastPFor<4, true> DeltaFastPFor128;
+  typedef SIMDCompressionLib::FastPFor<8, true> DeltaFastPFor256;
+
+  std::vector<CodecDescriptor> table;
+
+  table.push_back(makeCodec<SIMDCompressionLib::VByte<true> >("DeltaVariableByte", 1));
+  table.push_back(makeCodec<SIMDCompressionLib::VarIntGB<true> >("DeltaVarIntGB", 1));
+  table.push_back(makeCodec<DeltaBinaryPacking>("DeltaBinaryPacking", DeltaBinaryPacking::BlockSize));
+  table.push_back(makeCodec<DeltaFastPFor128>("DeltaFastPFor128", DeltaFastPFor128::BlockSize));
+  table.push_back(makeCodec<DeltaFastPFor256>("DeltaFastPFor256", DeltaFastPFor256::BlockSize));
+
+  table.push_back(makeFactoryCodec("DeltaMaskedVByte", "maskedvbyte"));
+  table.push_back(makeFactoryCodec("DeltaStreamVByte", "streamvbyte"));
+  table.push_back(makeFactoryCodec("S4BP128D1", "s4-bp128-d1"));
+  table.push_back(makeFactoryCodec("S4BP128D2", "s4-bp128-d2"));
+  table.push_back(makeFactoryCodec("S4BP128D4", "s4-bp128-d4"));
+  table.push_back(makeFactoryCodec("S4BP128DM", "s4-bp128-dm"));
+  table.push_back(makeFactoryCodec("S4BP128D1NI", "s4-bp128-d1-ni"));
+  table.push_back(makeFactoryCodec("S4BP128D2NI", "s4-bp128-d2-ni"));
+  table.push_back(makeFactoryCodec("S4BP128D4NI", "s4-bp128-d4-ni"));
+  table.push_back(makeFactoryCodec("S4BP128DMNI", "s4-bp128-dm-ni"));
+  table.push_back(makeFactoryCodec("S4FastPForD1", "s4-fastpfor-d1"));
+  table.push_back(makeFactoryCodec("S4FastPForD2", "s4-fastpfor-d2"));
+  table.push_back(makeFactoryCodec("S4FastPForD4", "s4-fastpfor-d4"));
+  table.push_back(makeFactoryCodec("S4FastPForDM", "s4-fastpfor-dm"));
+  table.push_back(makeFactoryCodec("FrameOfReference", "frameofreference"));
+  table.push_back(makeFactoryCodec("SIMDFrameOfReference", "simdframeofreference"));
+
+  table.push_back(makeCodec<DeltaOfDelta>("DeltaOfDelta", 1));
+  table.push_back(makeCodec<DeltaRunLength>("DeltaRunLength", 1));
+
+  return table;
+}
+
+const std::vector<CodecDescriptor>& CodecTable() {
+  static const std::vector<CodecDescriptor> table = makeCodecTable();
+  return table;
+}
+
+static std::vector<CodecDescriptor> makeUnsortedCodecTable() {
+  typedef SIMDCompressionLib::BinaryPacking<SIMDCompressionLib::NoDeltaBlockPacker> BinaryPacking;
+  typedef SIMDCompressionLib::FastPFor<4, false> FastPFor128;
+  typedef SIMDCompressionLib::FastPFor<8, false> FastPFor256;
+
+  std::vector<CodecDescriptor> table;
+
+  table.push_back(makeCodec<SIMDCompressionLib::VByte<false> >("VariableByte", 1));
+  table.push_back(makeCodec<SIMDCompressionLib::VarIntGB<false> >("VarIntGB", 1));
+  table.push_back(makeCodec<BinaryPacking>("BinaryPacking", BinaryPacking::BlockSize));
+  table.push_back(makeCodec<FastPFor128>("FastPFor128", FastPFor128::BlockSize));
+  table.push_back(makeCodec<FastPFor256>("FastPFor256", FastPFor256::BlockSize));
+
+  table.push_back(makeFactoryCodec("FrameOfReference", "frameofreference"));
+  table.push_back(makeFactoryCodec("SIMDFrameOfReference", "simdframeofreference"));
+
+  return table;
+}
+
+const std::vector<CodecDescriptor>& UnsortedCodecTable() {
+  static const std::vector<CodecDescriptor> table = makeUnsortedCodecTable();
+  return table;
+}
+
+const CodecDescriptor *FindCodec(const std::string& name) {
+  for (const CodecDescriptor& codec : CodecTable()) {
+    if (codec.name == name) {
+      return &codec;
+    }
+  }
+
+  return NULL;
+}
+
+static CodecDescriptor makeVTEncCodecDescriptor() {
+  CodecDescriptor desc;
+  desc.name = "VTEnc";
+  desc.blockSize = 1;
+  desc.create = []() {
+    return std::shared_ptr<SIMDCompressionLib::IntegerCODEC>(new VTEncCodec());
+  };
+  return desc;
+}
+
+const CodecDescriptor& VTEncCodecDescriptor() {
+  static const CodecDescriptor desc = makeVTEncCodecDescriptor();
+  return desc;
+}
+
+size_t EncodeWithFallback(
+  SIMDCompressionLib::IntegerCODEC& codec,
+  SIMDCompressionLib::IntegerCODEC& fallbackCodec,
+  size_t blockSize,
+  uint32_t *in,
+  size_t length,
+  uint32_t *out,
+  size_t capacity)
+{
+  size_t length2 = length % blockSize;
+  size_t length1 = length - length2;
+  size_t encodedLength1 = 0;
+  size_t encodedLength2 = 0;
+
+  if (length1) {
+    encodedLength1 = capacity;
+    codec.encodeArray(in, length1, out, encodedLength1);
+  }
+
+  if (length2) {
+    encodedLength2 = capacity - encodedLength1;
+    fallbackCodec.encodeArray(in + length1, length2, out + encodedLength1, encodedLength2);
+  }
+
+  return encodedLength1 + encodedLength2;
+}
+
+void DecodeWithFallback(
+  SIMDCompressionLib::IntegerCODEC& codec,
+  SIMDCompressionLib::IntegerCODEC& fallbackCodec,
+  size_t blockSize,
+  const uint32_t *in,
+  size_t encodedLength,
+  uint32_t *out,
+  size_t length)
+{
+  size_t length2 = length % blockSize;
+  size_t length1 = length - length2;
+  const uint32_t *in2 = in;
+
+  if (length1) {
+    size_t decodedLength = length1;
+    in2 = codec.decodeArray(in, encodedLength, out, decodedLength);
+  }
+
+  if (length2) {
+    size_t decodedLength = length2;
+    fallbackCodec.decodeArray(in2, encodedLength - (in2 - in), out + length1, decodedLength);
+  }
+}
+
+double SecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+double TimeEncode(SIMDCompressionUtil& comp, size_t repetitions) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (size_t r = 0; r < repetitions; ++r) {
+    comp.Reset();
+    comp.Encode();
+  }
+  const double encodeSeconds = SecondsSince(start);
+
+  start = std::chrono::steady_clock::now();
+  for (size_t r = 0; r < repetitions; ++r) {
+    comp.Reset();
+  }
+  const double resetSeconds = SecondsSince(start);
+
+  return std::max(encodeSeconds - resetSeconds, 0.0) / repetitions;
+}
+
+double TimeDecode(SIMDCompressionUtil& comp, size_t repetitions) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (size_t r = 0; r < repetitions; ++r) {
+    comp.Decode();
+  }
+
+  return SecondsSince(start) / repetitions;
+}
+
+LatencyHistogram::LatencyHistogram(): _counts(128 + 57 * 64, 0), _count(0), _max(0) {
+}
+
+size_t LatencyHistogram::bucketIndex(uint64_t value) {
+  if (value < 128) {
+    return value;
+  }
+
+  const size_t exponent = 63 - __builtin_clzll(value);
+  return 128 + (exponent - 7) * 64 + ((value >> (exponent - 6)) & 63);
+}
+
+uint64_t LatencyHistogram::bucketValue(size_t index) {
+  if (index < 128) {
+    return index;
+  }
+
+  const size_t exponent = (index - 128) / 64 + 7;
+  return (uint64_t(64 + (index - 128) % 64)) << (exponent - 6);
+}
+
+void LatencyHistogram::Add(uint64_t nanoseconds) {
+  _counts[bucketIndex(nanoseconds)]++;
+  _count++;
+  _max = std::max(_max, nanoseconds);
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+  for (size_t i = 0; i < _counts.size(); ++i) {
+    _counts[i] += other._counts[i];
+  }
+  _count += other._count;
+  _max = std::max(_max, other._max);
+}
+
+uint64_t LatencyHistogram::Count() const {
+  return _count;
+}
+
+uint64_t LatencyHistogram::Max() const {
+  return _max;
+}
+
+uint64_t LatencyHistogram::Percentile(double p) const {
+  const uint64_t rank = static_cast<uint64_t>(p / 100.0 * _count);
+  uint64_t seen = 0;
+
+  for (size_t i = 0; i < _counts.size(); ++i) {
+    seen += _counts[i];
+    if (seen > rank) {
+      return std::min(bucketValue(i), _max);
+    }
+  }
+
+  return _max;
+}
+
+ZipfDistribution::ZipfDistribution(size_t n, double s): _cdf(n) {
+  double sum = 0;
+
+  for (size_t i = 0; i < n; ++i) {
+    sum += 1.0 / std::pow(double(i + 1), s);
+    _cdf[i] = sum;
+  }
+
+  for (size_t i = 0; i < n; ++i) {
+    _cdf[i] /= sum;
+  }
+}
@@ -5,24 +5,103 @@
 #ifndef INTCOMPBENCH_COMMON_H_
 #define INTCOMPBENCH_COMMON_H_
 
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <new>
+#include <random>
 #include <string>
 #include <vector>
 
+#include "energy.h"
+#include "perfcounters.h"
+
 #include "benchmark/include/benchmark/benchmark.h"
 #include "SIMDCompressionAndIntersection/include/codecs.h"
 #include "SIMDCompressionAndIntersection/include/variablebyte.h"
 
+// Kind of pages that back the large benchmark buffers (--hugepages option).
+enum HugePagesMode {
+  HUGE_PAGES_OFF,
+  HUGE_PAGES_THP,
+  HUGE_PAGES_HUGETLB
+};
+
 struct GlobalState {
   static std::string dataDirectory;
+  static std::string scratchDirectory;
+  // Name of the gov2.sorted-like file in the data directory (--gov2-file).
+  static std::string gov2File;
+  // Share of the gov2 lists in the stratified sample (--gov2-sample), or 0 to
+  // benchmark the whole file.
+  static double gov2SampleFraction;
+  static HugePagesMode hugePages;
 };
 
+// Allocates buffers of `bytes` bytes backed by the given kind of pages.
+// Buffers smaller than a huge page always come from the regular heap.
+void *AllocateBuffer(size_t bytes, HugePagesMode mode);
+void FreeBuffer(void *ptr, size_t bytes, HugePagesMode mode);
+
+// Allocator for the data, encoded and decoded buffers of the benchmarks. It
+// takes the kind of pages from GlobalState::hugePages when it is created.
+template <class T>
+class HugePageAllocator {
+public:
+  typedef T value_type;
+
+  HugePagesMode mode;
+
+  HugePageAllocator(): mode(GlobalState::hugePages) {}
+
+  template <class U>
+  HugePageAllocator(const HugePageAllocator<U>& other): mode(other.mode) {}
+
+  T *allocate(size_t n) {
+    return static_cast<T *>(AllocateBuffer(n * sizeof(T), mode));
+  }
+
+  void deallocate(T *ptr, size_t n) {
+    FreeBuffer(ptr, n * sizeof(T), mode);
+  }
+};
+
+template <class T, class U>
+bool operator==(const HugePageAllocator<T>& a, const HugePageAllocator<U>& b) {
+  return a.mode == b.mode;
+}
+
+template <class T, class U>
+bool operator!=(const HugePageAllocator<T>& a, const HugePageAllocator<U>& b) {
+  return a.mode != b.mode;
+}
+
+template <class T>
+using HugePageVector = std::vector<T, HugePageAllocator<T> >;
+
+// Reports the lengths, compression ratio and throughput of a benchmark, and
+// the energy consumed and the data TLB misses incurred by it. Those are
+// measured from the construction to SetFinalStats(), leaving out the parts
+// where the timer is paused through PauseTiming(), so build it right before
+// the timed loop and call SetFinalStats() right after it, before checking the
+// results.
 class CompressionStats {
 private:
   benchmark::State& _state;
+  EnergyMeter _energyMeter;
+  TLBCounters _tlbCounters;
 
 public:
   CompressionStats(benchmark::State& state);
 
+  // Pause and resume the timer of the benchmark, the energy meter and the
+  // TLB counters.
+  void PauseTiming();
+  void ResumeTiming();
+
   void SetInputLengthInBytes(size_t len);
   void UpdateInputLengthInBytes(size_t len);
   void ResetInputLengthInBytes();
@@ -33,19 +112,25 @@ public:
   void Reset();
 };
 
+// Encodes and decodes a list with a block codec. The integers that do not
+// fill a whole block are encoded with a fallback codec, VByte<true> by
+// default. When a small-list threshold is given, lists shorter than it are
+// entirely encoded with the fallback codec.
 class SIMDCompressionUtil {
 private:
-  SIMDCompressionLib::VByte<true> _fallbackCodec;
+  SIMDCompressionLib::VByte<true> _defaultFallbackCodec;
   SIMDCompressionLib::IntegerCODEC& _codec;
+  SIMDCompressionLib::IntegerCODEC& _fallbackCodec;
   std::vector<uint32_t>& _data;
+  bool _smallList;
   size_t _inputLength;
   size_t _inputLength1;
   size_t _inputLength2;
-  std::vector<uint32_t> _copyOfData;
-  std::vector<uint32_t> _encoded;
+  HugePageVector<uint32_t> _copyOfData;
+  HugePageVector<uint32_t> _encoded;
   size_t _encodedLength1;
   size_t _encodedLength2;
-  std::vector<uint32_t> _decoded;
+  HugePageVector<uint32_t> _decoded;
 
 public:
   SIMDCompressionUtil(
@@ -53,12 +138,268 @@ public:
     size_t blockSize,
     std::vector<uint32_t>& data);
 
+  SIMDCompressionUtil(
+    SIMDCompressionLib::IntegerCODEC& codec,
+    size_t blockSize,
+    std::vector<uint32_t>& data,
+    SIMDCompressionLib::IntegerCODEC& fallbackCodec,
+    size_t smallListThreshold);
+
   void Reset();
   void Encode();
+  void EncodeBlocks();
+  void EncodeTail();
   void Decode();
+  void DecodeBlocks();
+  void DecodeTail();
   size_t InputLength();
   size_t EncodedLength();
+  size_t TailInputLength();
+  size_t TailEncodedLength();
   void EqualityCheck();
+  // The integers written by the last call to Decode().
+  const uint32_t *DecodedData() const;
+};
+
+// Sequential reader of a gov2.sorted-like file: a sequence of sorted lists,
+// each one stored as its length followed by its values, all of them 32-bit
+// integers.
+class Gov2SortedFile {
+private:
+  std::ifstream _inFile;
+  char _buffer[4096];
+  size_t _bufferCount;
+  size_t _bufferOffset;
+
+  void refreshBuffer();
+  uint32_t readNextUint32();
+
+public:
+  void Open(const std::string& fileName);
+  void Close();
+  bool LoadNextSet(std::vector<uint32_t>& data);
+};
+
+// Returns the path of the gov2 lists: GlobalState::gov2File in the data
+// directory.
+std::string Gov2SortedPath();
+
+// Loads into memory the lists of Gov2SortedPath() whose length is in
+// [minLength, maxLength).
+void LoadGov2SortedSets(
+  std::vector<std::vector<uint32_t> >& sets,
+  size_t minLength,
+  size_t maxLength);
+
+// Loads a uniform random sample of at most `sampleSize` of the lists of
+// gov2.sorted whose length is in [minLength, maxLength). The file is read once
+// and only the sample is kept in memory.
+void SampleGov2SortedSets(
+  std::vector<std::vector<uint32_t> >& sets,
+  size_t minLength,
+  size_t maxLength,
+  size_t sampleSize,
+  uint64_t seed);
+
+// A SIMDCompressionAndIntersection codec benchmarked on every data set.
+// `blockSize` is the number of integers the codec works with at once; the
+// trailing `length % blockSize` integers are encoded with VByte<true>.
+// Codecs that deal with any length by themselves use a block size of 1.
+struct CodecDescriptor {
+  std::string name;
+  size_t blockSize;
+  std::function<std::shared_ptr<SIMDCompressionLib::IntegerCODEC>()> create;
+};
+
+// Returns the table of codecs benchmarked on every data set.
+const std::vector<CodecDescriptor>& CodecTable();
+
+// Returns the table of codecs without delta coding, benchmarked on the
+// unsorted data sets. Their tails go to VByte<false>.
+const std::vector<CodecDescriptor>& UnsortedCodecTable();
+
+// Returns the codec of the table with the given name, or NULL.
+const CodecDescriptor *FindCodec(const std::string& name);
+
+// VTEnc with min_cluster_length 1, through VTEncCodec. It is not part of the
+// codec table because the data set benchmarks use VTEnc directly.
+const CodecDescriptor& VTEncCodecDescriptor();
+
+// Encodes `length` integers the way SIMDCompressionUtil does: those that fill
+// whole blocks with `codec` and the rest with `fallbackCodec`. Returns the
+// number of words written to `out`.
+size_t EncodeWithFallback(
+  SIMDCompressionLib::IntegerCODEC& codec,
+  SIMDCompressionLib::IntegerCODEC& fallbackCodec,
+  size_t blockSize,
+  uint32_t *in,
+  size_t length,
+  uint32_t *out,
+  size_t capacity);
+
+// Decodes `length` integers encoded with EncodeWithFallback().
+void DecodeWithFallback(
+  SIMDCompressionLib::IntegerCODEC& codec,
+  SIMDCompressionLib::IntegerCODEC& fallbackCodec,
+  size_t blockSize,
+  const uint32_t *in,
+  size_t encodedLength,
+  uint32_t *out,
+  size_t length);
+
+// Seconds elapsed since `start`.
+double SecondsSince(std::chrono::steady_clock::time_point start);
+
+// Seconds that encoding `comp` takes, on average over `repetitions` encodings
+// in a row. Encoding overwrites the input of the delta codecs, so it is
+// restored every time, and the time that takes is subtracted.
+double TimeEncode(SIMDCompressionUtil& comp, size_t repetitions);
+
+// Seconds that decoding `comp` takes, on average over `repetitions` decodings
+// in a row. `comp` must have been encoded.
+double TimeDecode(SIMDCompressionUtil& comp, size_t repetitions);
+
+// Histogram of latencies in nanoseconds. Values below 128 are exact; above,
+// every power of two is split into 64 buckets, which keeps the error of the
+// percentiles below 2%.
+class LatencyHistogram {
+private:
+  std::vector<uint64_t> _counts;
+  uint64_t _count;
+  uint64_t _max;
+
+  static size_t bucketIndex(uint64_t value);
+  static uint64_t bucketValue(size_t index);
+
+public:
+  LatencyHistogram();
+
+  void Add(uint64_t nanoseconds);
+  void Merge(const LatencyHistogram& other);
+  uint64_t Count() const;
+  uint64_t Max() const;
+  uint64_t Percentile(double p) const;
+};
+
+// Draws ranks in [0, n) with probability proportional to 1 / (rank + 1)^s.
+class ZipfDistribution {
+private:
+  std::vector<double> _cdf;
+
+public:
+  ZipfDistribution(size_t n, double s);
+
+  template <class Generator>
+  size_t operator()(Generator& generator) const {
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    size_t rank = std::upper_bound(_cdf.begin(), _cdf.end(), uniform(generator)) - _cdf.begin();
+    return std::min(rank, _cdf.size() - 1);
+  }
+};
+
+// Fixture benchmark whose body is given at run time, so that one benchmark
+// can be registered per entry of the codec table. This does the same as the
+// BENCHMARK_F macros.
+template <class Fixture>
+class CodecBenchmark : public Fixture {
+public:
+  typedef void (*Function)(Fixture* obj, const CodecDescriptor& codec, benchmark::State& state);
+
+private:
+  const CodecDescriptor& _codec;
+  Function _func;
+
+public:
+  CodecBenchmark(const std::string& name, const CodecDescriptor& codec, Function func)
+    : _codec(codec), _func(func)
+  {
+    this->SetName(name.c_str());
+  }
+
+protected:
+  void BenchmarkCase(benchmark::State& state) {
+    _func(this, _codec, state);
+  }
 };
 
+// Registers the benchmark "<fixtureName>/<codec name><method>" for every codec
+// in `codecs`, the codec table by default, and returns them, so that
+// arguments can be added.
+template <class Fixture>
+std::vector<benchmark::internal::Benchmark*> RegisterCodecBenchmarks(
+  const std::string& fixtureName,
+  const std::string& method,
+  typename CodecBenchmark<Fixture>::Function func,
+  const std::vector<CodecDescriptor>& codecs = CodecTable())
+{
+  std::vector<benchmark::internal::Benchmark*> benchmarks;
+
+  for (const CodecDescriptor& codec : codecs) {
+    const std::string name = fixtureName + "/" + codec.name + method;
+    benchmarks.push_back(benchmark::internal::RegisterBenchmarkInternal(
+      new CodecBenchmark<Fixture>(name, codec, func)));
+  }
+
+  return benchmarks;
+}
+
+// Same as RegisterCodecBenchmarks(), for VTEnc (VTEncCodecDescriptor()) and
+// then every codec of the table.
+template <class Fixture>
+std::vector<benchmark::internal::Benchmark*> RegisterVTEncAndCodecBenchmarks(
+  const std::string& fixtureName,
+  const std::string& method,
+  typename CodecBenchmark<Fixture>::Function func)
+{
+  const CodecDescriptor& vtenc = VTEncCodecDescriptor();
+  std::vector<benchmark::internal::Benchmark*> benchmarks(1, benchmark::internal::RegisterBenchmarkInternal(
+    new CodecBenchmark<Fixture>(fixtureName + "/" + vtenc.name + method, vtenc, func)));
+
+  for (benchmark::internal::Benchmark *b : RegisterCodecBenchmarks<Fixture>(fixtureName, method, func)) {
+    benchmarks.push_back(b);
+  }
+
+  return benchmarks;
+}
+
+// Fixture whose data is a random sample of at most `SampleSize` lists of
+// gov2.sorted whose length is in [MinLength, MaxLength), drawn with
+// SampleGov2SortedSets() the first time it is needed. Fixtures with the same
+// parameters share the sample.
+template <size_t SampleSize, size_t MinLength, size_t MaxLength, uint64_t Seed>
+class SampledGov2Fixture : public benchmark::Fixture {
+public:
+  static std::vector<std::vector<uint32_t> > sample;
+
+  void SetUp(const ::benchmark::State& state) {
+    if (sample.empty()) {
+      SampleGov2SortedSets(sample, MinLength, MaxLength, SampleSize, Seed);
+    }
+  }
+
+  void TearDown(const ::benchmark::State& state) {}
+
+  // Returns a new instance of the codec, or skips the benchmark and returns
+  // NULL when the codec is not available or the sample is empty.
+  static std::shared_ptr<SIMDCompressionLib::IntegerCODEC> CreateCodec(
+    const CodecDescriptor& desc,
+    benchmark::State& state)
+  {
+    std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = desc.create();
+
+    if (!codec) {
+      state.SkipWithError("codec not available");
+    } else if (sample.empty()) {
+      state.SkipWithError("no lists in the sample");
+      codec.reset();
+    }
+
+    return codec;
+  }
+};
+
+template <size_t SampleSize, size_t MinLength, size_t MaxLength, uint64_t Seed>
+std::vector<std::vector<uint32_t> > SampledGov2Fixture<SampleSize, MinLength, MaxLength, Seed>::sample =
+  std::vector<std::vector<uint32_t> >();
+
 #endif // INTCOMPBENCH_COMMON_H_
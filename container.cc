@@ -0,0 +1,479 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#include "container.h"
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "SIMDCompressionAndIntersection/include/codecs.h"
+#include "SIMDCompressionAndIntersection/include/variablebyte.h"
+
+static std::runtime_error systemError(const std::string& what, int error) {
+  return std::runtime_error(what + ": " + std::strerror(error));
+}
+
+// Reads exactly `bytes` bytes at `offset`.
+static void readFully(int fd, void *buffer, size_t bytes, uint64_t offset) {
+  uint8_t *out = static_cast<uint8_t *>(buffer);
+
+  while (bytes > 0) {
+    ssize_t n = pread(fd, out, bytes, offset);
+
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      throw systemError("pread", errno);
+    }
+    if (n == 0) {
+      throw std::runtime_error("unexpected end of container file");
+    }
+
+    out += n;
+    bytes -= n;
+    offset += n;
+  }
+}
+
+static void writeFully(int fd, const void *buffer, size_t bytes) {
+  const uint8_t *in = static_cast<const uint8_t *>(buffer);
+
+  while (bytes > 0) {
+    ssize_t n = write(fd, in, bytes);
+
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      throw systemError("write", errno);
+    }
+
+    in += n;
+    bytes -= n;
+  }
+}
+
+ListContainer::ListContainer(
+  const std::string& path,
+  SIMDCompressionLib::IntegerCODEC& codec,
+  size_t blockSize,
+  const std::vector<std::vector<uint32_t> >& lists): _path(path), _fd(-1), _blockSize(blockSize), _fileSize(0)
+{
+  SIMDCompressionLib::VByte<true> fallbackCodec;
+  std::vector<uint32_t> copyOfList;
+  std::vector<uint32_t> buffer;
+  std::vector<Entry> index;
+  uint64_t offset = 0;
+
+  int fd = open(path.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+  if (fd < 0) {
+    throw systemError("failed to create '" + path + "'", errno);
+  }
+
+  for (const std::vector<uint32_t>& list : lists) {
+    // Codecs are allowed to modify their input.
+    copyOfList.assign(list.begin(), list.end());
+    buffer.resize(list.size() + 1024);
+
+    size_t encodedLength = EncodeWithFallback(codec, fallbackCodec, _blockSize,
+      copyOfList.data(), copyOfList.size(), buffer.data(), buffer.size());
+
+    Entry entry;
+    entry.offset = offset;
+    entry.encodedLength = static_cast<uint32_t>(encodedLength);
+    entry.length = static_cast<uint32_t>(list.size());
+    index.push_back(entry);
+
+    writeFully(fd, buffer.data(), encodedLength * sizeof(uint32_t));
+    offset += encodedLength * sizeof(uint32_t);
+  }
+
+  const uint64_t footer[2] = {index.size(), offset};
+  writeFully(fd, index.data(), index.size() * sizeof(Entry));
+  writeFully(fd, footer, sizeof(footer));
+
+  // Only clean pages can be dropped from the page cache.
+  fsync(fd);
+  close(fd);
+
+  // The index is read back from the file.
+  _fd = open(path.c_str(), O_RDONLY);
+  if (_fd < 0) {
+    throw systemError("failed to open '" + path + "'", errno);
+  }
+
+  uint64_t readFooter[2];
+  _fileSize = lseek(_fd, 0, SEEK_END);
+  readFully(_fd, readFooter, sizeof(readFooter), _fileSize - sizeof(readFooter));
+  _index.resize(readFooter[0]);
+  readFully(_fd, _index.data(), _index.size() * sizeof(Entry), readFooter[1]);
+}
+
+ListContainer::~ListContainer() {
+  if (_fd >= 0) {
+    close(_fd);
+  }
+  unlink(_path.c_str());
+}
+
+int ListContainer::FileDescriptor() const {
+  return _fd;
+}
+
+uint64_t ListContainer::FileSize() const {
+  return _fileSize;
+}
+
+size_t ListContainer::NumLists() const {
+  return _index.size();
+}
+
+const ListContainer::Entry& ListContainer::GetEntry(size_t list) const {
+  return _index[list];
+}
+
+size_t ListContainer::MaxEncodedLengthInBytes() const {
+  size_t maxLength = 0;
+
+  for (const Entry& entry : _index) {
+    maxLength = std::max(maxLength, size_t(entry.encodedLength) * sizeof(uint32_t));
+  }
+
+  return maxLength;
+}
+
+size_t ListContainer::MaxLength() const {
+  size_t maxLength = 0;
+
+  for (const Entry& entry : _index) {
+    maxLength = std::max(maxLength, size_t(entry.length));
+  }
+
+  return maxLength;
+}
+
+void ListContainer::DropPageCache() const {
+  posix_fadvise(_fd, 0, 0, POSIX_FADV_DONTNEED);
+}
+
+void ListContainer::Decode(
+  SIMDCompressionLib::IntegerCODEC& codec,
+  size_t list,
+  const uint32_t *encoded,
+  uint32_t *out) const
+{
+  SIMDCompressionLib::VByte<true> fallbackCodec;
+  const Entry& entry = _index[list];
+
+  DecodeWithFallback(codec, fallbackCodec, _blockSize, encoded, entry.encodedLength, out, entry.length);
+}
+
+static int ioUringSetup(unsigned entries, struct io_uring_params *params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, NULL, 0));
+}
+
+static int ioUringRegister(int fd, unsigned opcode, const void *arg, unsigned numArgs) {
+  return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, numArgs));
+}
+
+IoUringFetcher::IoUringFetcher(const ListContainer& container, const CodecDescriptor& desc, unsigned depth)
+  : _container(container), _codec(desc.create()), _depth(depth), _ringFd(-1),
+    _sqRing(MAP_FAILED), _sqRingSize(0), _cqRing(MAP_FAILED), _cqRingSize(0), _sqes(NULL), _sqesSize(0)
+{
+  struct io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+
+  _ringFd = ioUringSetup(depth, &params);
+  if (_ringFd < 0) {
+    throw systemError("io_uring_setup", errno);
+  }
+
+  _sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  _cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    _sqRingSize = _cqRingSize = std::max(_sqRingSize, _cqRingSize);
+  }
+
+  _sqRing = mmap(NULL, _sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ringFd, IORING_OFF_SQ_RING);
+  if (_sqRing == MAP_FAILED) {
+    int error = errno;
+    unmapRings();
+    throw systemError("mmap of the io_uring submission ring", error);
+  }
+
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    _cqRing = _sqRing;
+  } else {
+    _cqRing = mmap(NULL, _cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ringFd, IORING_OFF_CQ_RING);
+    if (_cqRing == MAP_FAILED) {
+      int error = errno;
+      unmapRings();
+      throw systemError("mmap of the io_uring completion ring", error);
+    }
+  }
+
+  _sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+  void *sqes = mmap(NULL, _sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ringFd, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    int error = errno;
+    unmapRings();
+    throw systemError("mmap of the io_uring submission entries", error);
+  }
+  _sqes = static_cast<struct io_uring_sqe *>(sqes);
+
+  uint8_t *sq = static_cast<uint8_t *>(_sqRing);
+  uint8_t *cq = static_cast<uint8_t *>(_cqRing);
+  _sqHead = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+  _sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+  _sqMask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+  _sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+  _cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+  _cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+  _cqMask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+  _cqes = reinterpret_cast<struct io_uring_cqe *>(cq + params.cq_off.cqes);
+
+  // One registered buffer per read in flight, large enough for any list.
+  const size_t bufferLength = container.MaxEncodedLengthInBytes() / sizeof(uint32_t) + 1;
+  _buffers.resize(depth);
+  _iovecs.resize(depth);
+
+  for (unsigned i = 0; i < depth; ++i) {
+    _buffers[i].resize(bufferLength);
+    _iovecs[i].iov_base = _buffers[i].data();
+    _iovecs[i].iov_len = bufferLength * sizeof(uint32_t);
+  }
+
+  if (ioUringRegister(_ringFd, IORING_REGISTER_BUFFERS, _iovecs.data(), depth) < 0) {
+    int error = errno;
+    unmapRings();
+    throw systemError("io_uring_register", error);
+  }
+
+  _decoded.resize(container.MaxLength());
+}
+
+void IoUringFetcher::unmapRings() {
+  if (_sqes) {
+    munmap(_sqes, _sqesSize);
+    _sqes = NULL;
+  }
+  if (_cqRing != MAP_FAILED && _cqRing != _sqRing) {
+    munmap(_cqRing, _cqRingSize);
+  }
+  _cqRing = MAP_FAILED;
+  if (_sqRing != MAP_FAILED) {
+    munmap(_sqRing, _sqRingSize);
+    _sqRing = MAP_FAILED;
+  }
+  if (_ringFd >= 0) {
+    close(_ringFd);
+    _ringFd = -1;
+  }
+}
+
+IoUringFetcher::~IoUringFetcher() {
+  unmapRings();
+}
+
+void IoUringFetcher::Fetch(const std::vector<uint32_t>& lists, const ListFetcher::Consumer& consume) {
+  std::vector<unsigned> freeSlots;
+  std::vector<uint32_t> slotLists(_depth);
+  size_t next = 0;
+  size_t inFlight = 0;
+
+  for (unsigned slot = 0; slot < _depth; ++slot) {
+    freeSlots.push_back(slot);
+  }
+
+  while (next < lists.size() || inFlight > 0) {
+    unsigned tail = *_sqTail;
+
+    while (next < lists.size() && !freeSlots.empty()) {
+      const unsigned slot = freeSlots.back();
+      const ListContainer::Entry& entry = _container.GetEntry(lists[next]);
+      const unsigned index = tail & *_sqMask;
+      struct io_uring_sqe *sqe = &_sqes[index];
+
+      freeSlots.pop_back();
+      slotLists[slot] = lists[next];
+
+      std::memset(sqe, 0, sizeof(*sqe));
+      sqe->opcode = IORING_OP_READ_FIXED;
+      sqe->fd = _container.FileDescriptor();
+      sqe->off = entry.offset;
+      sqe->addr = reinterpret_cast<uint64_t>(_buffers[slot].data());
+      sqe->len = entry.encodedLength * sizeof(uint32_t);
+      sqe->buf_index = slot;
+      sqe->user_data = slot;
+      _sqArray[index] = index;
+
+      tail++;
+      next++;
+      inFlight++;
+    }
+
+    __atomic_store_n(_sqTail, tail, __ATOMIC_RELEASE);
+
+    // Every entry that the kernel has not consumed yet, including those left
+    // over by an interrupted or partial submission in a previous pass.
+    const unsigned toSubmit = tail - __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE);
+
+    if (ioUringEnter(_ringFd, toSubmit, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+      throw systemError("io_uring_enter", errno);
+    }
+
+    unsigned head = *_cqHead;
+
+    while (head != __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE)) {
+      const struct io_uring_cqe *cqe = &_cqes[head & *_cqMask];
+      const unsigned slot = static_cast<unsigned>(cqe->user_data);
+      const size_t list = slotLists[slot];
+      const ListContainer::Entry& entry = _container.GetEntry(list);
+
+      if (cqe->res < 0) {
+        throw systemError("io_uring read", -cqe->res);
+      }
+      if (size_t(cqe->res) != entry.encodedLength * sizeof(uint32_t)) {
+        throw std::runtime_error("short read from container file");
+      }
+
+      _container.Decode(*_codec, list, _buffers[slot].data(), _decoded.data());
+      consume(list, _decoded.data(), entry.length);
+
+      freeSlots.push_back(slot);
+      inFlight--;
+      head++;
+    }
+
+    __atomic_store_n(_cqHead, head, __ATOMIC_RELEASE);
+  }
+}
+
+PreadPoolFetcher::PreadPoolFetcher(const ListContainer& container, const CodecDescriptor& desc, size_t numThreads)
+  : _container(container), _desc(desc), _batch(NULL), _consume(NULL), _next(0),
+    _generation(0), _busyThreads(0), _stop(false)
+{
+  for (size_t i = 0; i < numThreads; ++i) {
+    _threads.push_back(std::thread(&PreadPoolFetcher::worker, this));
+  }
+}
+
+PreadPoolFetcher::~PreadPoolFetcher() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stop = true;
+  }
+  _startCondition.notify_all();
+
+  for (std::thread& thread : _threads) {
+    thread.join();
+  }
+}
+
+void PreadPoolFetcher::worker() {
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = _desc.create();
+  std::vector<uint32_t> encoded(_container.MaxEncodedLengthInBytes() / sizeof(uint32_t) + 1);
+  std::vector<uint32_t> decoded(_container.MaxLength());
+  uint64_t generation = 0;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _startCondition.wait(lock, [&]() { return _stop || _generation != generation; });
+      if (_stop) {
+        return;
+      }
+      generation = _generation;
+    }
+
+    try {
+      for (size_t i = _next++; i < _batch->size(); i = _next++) {
+        const size_t list = (*_batch)[i];
+        const ListContainer::Entry& entry = _container.GetEntry(list);
+
+        readFully(_container.FileDescriptor(), encoded.data(), entry.encodedLength * sizeof(uint32_t), entry.offset);
+        _container.Decode(*codec, list, encoded.data(), decoded.data());
+        (*_consume)(list, decoded.data(), entry.length);
+      }
+    } catch (const std::exception& e) {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _error = e.what();
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (--_busyThreads == 0) {
+        _doneCondition.notify_one();
+      }
+    }
+  }
+}
+
+void PreadPoolFetcher::Fetch(const std::vector<uint32_t>& lists, const ListFetcher::Consumer& consume) {
+  std::unique_lock<std::mutex> lock(_mutex);
+
+  _batch = &lists;
+  _consume = &consume;
+  _next = 0;
+  _busyThreads = _threads.size();
+  _generation++;
+  _startCondition.notify_all();
+  _doneCondition.wait(lock, [&]() { return _busyThreads == 0; });
+
+  if (!_error.empty()) {
+    std::string error = _error;
+    _error.clear();
+    throw std::runtime_error(error);
+  }
+}
+
+MmapFetcher::MmapFetcher(const ListContainer& container, const CodecDescriptor& desc)
+  : _container(container), _codec(desc.create()), _mapping(NULL), _decoded(container.MaxLength())
+{
+}
+
+MmapFetcher::~MmapFetcher() {
+  Reset();
+}
+
+void MmapFetcher::Fetch(const std::vector<uint32_t>& lists, const ListFetcher::Consumer& consume) {
+  if (!_mapping) {
+    void *mapping = mmap(NULL, _container.FileSize(), PROT_READ, MAP_SHARED, _container.FileDescriptor(), 0);
+    if (mapping == MAP_FAILED) {
+      throw systemError("mmap of the container file", errno);
+    }
+    madvise(mapping, _container.FileSize(), MADV_RANDOM);
+    _mapping = static_cast<const uint8_t *>(mapping);
+  }
+
+  for (uint32_t list : lists) {
+    const ListContainer::Entry& entry = _container.GetEntry(list);
+    const uint32_t *encoded = reinterpret_cast<const uint32_t *>(_mapping + entry.offset);
+
+    _container.Decode(*_codec, list, encoded, _decoded.data());
+    consume(list, _decoded.data(), entry.length);
+  }
+}
+
+// The pages of a mapping are not dropped from the page cache while it is
+// mapped.
+void MmapFetcher::Reset() {
+  if (_mapping) {
+    munmap(const_cast<uint8_t *>(_mapping), _container.FileSize());
+    _mapping = NULL;
+  }
+}
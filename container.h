@@ -0,0 +1,175 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#ifndef INTCOMPBENCH_CONTAINER_H_
+#define INTCOMPBENCH_CONTAINER_H_
+
+#include <sys/uio.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common.h"
+
+#include "SIMDCompressionAndIntersection/include/codecs.h"
+
+// File that holds many encoded lists, one after the other, followed by an
+// index with the offset and the length of every list and by a footer with the
+// number of lists and the offset of the index. As in ListStore, the integers
+// of a list that fill whole blocks are encoded with the codec and the rest
+// with VByte<true>.
+class ListContainer {
+public:
+  struct Entry {
+    uint64_t offset;
+    uint32_t encodedLength;
+    uint32_t length;
+  };
+
+private:
+  std::string _path;
+  int _fd;
+  size_t _blockSize;
+  std::vector<Entry> _index;
+  uint64_t _fileSize;
+
+  ListContainer(const ListContainer&);
+  ListContainer& operator=(const ListContainer&);
+
+public:
+  // Writes the lists to `path` and opens the file.
+  ListContainer(
+    const std::string& path,
+    SIMDCompressionLib::IntegerCODEC& codec,
+    size_t blockSize,
+    const std::vector<std::vector<uint32_t> >& lists);
+  // Closes and removes the file.
+  ~ListContainer();
+
+  int FileDescriptor() const;
+  uint64_t FileSize() const;
+  size_t NumLists() const;
+  const Entry& GetEntry(size_t list) const;
+  size_t MaxEncodedLengthInBytes() const;
+  size_t MaxLength() const;
+  // Evicts the file from the page cache, so that the next reads go to the
+  // device.
+  void DropPageCache() const;
+  // Decodes a list read from the file. `encoded` must hold the whole list.
+  void Decode(
+    SIMDCompressionLib::IntegerCODEC& codec,
+    size_t list,
+    const uint32_t *encoded,
+    uint32_t *out) const;
+};
+
+// Reads and decodes batches of lists of a ListContainer. Every list is handed
+// to the consumer as soon as it is decoded, possibly from several threads.
+class ListFetcher {
+public:
+  typedef std::function<void(size_t list, const uint32_t *values, size_t length)> Consumer;
+
+  virtual ~ListFetcher() {}
+
+  virtual void Fetch(const std::vector<uint32_t>& lists, const Consumer& consume) = 0;
+  // Releases anything that would keep the file in memory.
+  virtual void Reset() {}
+};
+
+// Submits the reads of a batch through io_uring, with up to `depth` reads in
+// flight into registered buffers, and decodes every list as its read
+// completes. The ring is set up with the raw system calls.
+class IoUringFetcher : public ListFetcher {
+private:
+  const ListContainer& _container;
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> _codec;
+  unsigned _depth;
+  int _ringFd;
+  void *_sqRing;
+  size_t _sqRingSize;
+  void *_cqRing;
+  size_t _cqRingSize;
+  struct io_uring_sqe *_sqes;
+  size_t _sqesSize;
+  unsigned *_sqHead;
+  unsigned *_sqTail;
+  unsigned *_sqMask;
+  unsigned *_sqArray;
+  unsigned *_cqHead;
+  unsigned *_cqTail;
+  unsigned *_cqMask;
+  struct io_uring_cqe *_cqes;
+  std::vector<HugePageVector<uint32_t> > _buffers;
+  std::vector<struct iovec> _iovecs;
+  std::vector<uint32_t> _decoded;
+
+  IoUringFetcher(const IoUringFetcher&);
+  IoUringFetcher& operator=(const IoUringFetcher&);
+
+  void unmapRings();
+
+public:
+  IoUringFetcher(const ListContainer& container, const CodecDescriptor& desc, unsigned depth);
+  ~IoUringFetcher();
+
+  void Fetch(const std::vector<uint32_t>& lists, const ListFetcher::Consumer& consume);
+};
+
+// Splits every batch among `numThreads` threads, each of which reads its lists
+// with pread() and decodes them with its own instance of the codec.
+class PreadPoolFetcher : public ListFetcher {
+private:
+  const ListContainer& _container;
+  const CodecDescriptor& _desc;
+  std::vector<std::thread> _threads;
+  std::mutex _mutex;
+  std::condition_variable _startCondition;
+  std::condition_variable _doneCondition;
+  const std::vector<uint32_t> *_batch;
+  const ListFetcher::Consumer *_consume;
+  std::atomic<size_t> _next;
+  uint64_t _generation;
+  size_t _busyThreads;
+  bool _stop;
+  std::string _error;
+
+  PreadPoolFetcher(const PreadPoolFetcher&);
+  PreadPoolFetcher& operator=(const PreadPoolFetcher&);
+
+  void worker();
+
+public:
+  PreadPoolFetcher(const ListContainer& container, const CodecDescriptor& desc, size_t numThreads);
+  ~PreadPoolFetcher();
+
+  void Fetch(const std::vector<uint32_t>& lists, const ListFetcher::Consumer& consume);
+};
+
+// Maps the whole file and decodes the lists straight from the mapping, so
+// that the reads happen on page faults.
+class MmapFetcher : public ListFetcher {
+private:
+  const ListContainer& _container;
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> _codec;
+  const uint8_t *_mapping;
+  std::vector<uint32_t> _decoded;
+
+  MmapFetcher(const MmapFetcher&);
+  MmapFetcher& operator=(const MmapFetcher&);
+
+public:
+  MmapFetcher(const ListContainer& container, const CodecDescriptor& desc);
+  ~MmapFetcher();
+
+  void Fetch(const std::vector<uint32_t>& lists, const ListFetcher::Consumer& consume);
+  void Reset();
+};
+
+#endif // INTCOMPBENCH_CONTAINER_H_
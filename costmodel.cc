@@ -0,0 +1,355 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#include "costmodel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "stratified.h"
+
+#include "SIMDCompressionAndIntersection/include/codecs.h"
+
+// Synthetic lists: every length times every number of bits per gap, as long
+// as the integers fit in 32 bits.
+static const size_t syntheticLengths[] = {16, 128, 1024, 8192, 65536, 524288};
+static const unsigned syntheticBits[] = {1, 2, 4, 6, 8, 10, 12, 16, 20};
+
+// Length of the runs of consecutive integers of the clustered lists.
+static const size_t clusterLength = 32;
+
+// Share of the lists of every stratum of gov2 in the sample, which takes at
+// least two lists of each: one to fit the models and one to check them.
+static const double gov2SampleFraction = 1e-4;
+
+// Every list is encoded or decoded at least this many integers' worth of
+// times in a row, and the best of `timingRounds` rounds is kept.
+static const size_t minTimedIntegers = 1 << 16;
+static const size_t timingRounds = 3;
+
+struct CodecCosts {
+  std::string name;
+  size_t blockSize;
+  CostModel encode;
+  CostModel decode;
+  // Relative errors of the predictions on the held-out gov2 lists.
+  std::vector<double> encodeErrors;
+  std::vector<double> decodeErrors;
+  // Relative error of the predicted time of all the held-out lists.
+  double encodeTotalError;
+  double decodeTotalError;
+};
+
+double BitsPerGap(const std::vector<uint32_t>& list) {
+  if (list.empty()) {
+    return 0.0;
+  }
+  return std::log2(1.0 + (double(list.back()) - double(list.front())) / list.size());
+}
+
+CostModel FitCostModel(const std::vector<CostSample>& samples) {
+  // Normal equations of the least squares fit of y = a + b * n + c * n * bits
+  // with weights 1 / y^2.
+  double m[3][4] = {{0}};
+
+  for (const CostSample& sample : samples) {
+    if (sample.nanoseconds <= 0) {
+      continue;
+    }
+
+    const double x[3] = {1.0, double(sample.length), double(sample.length) * sample.bitsPerGap};
+    const double w = 1.0 / (sample.nanoseconds * sample.nanoseconds);
+
+    for (size_t i = 0; i < 3; ++i) {
+      for (size_t j = 0; j < 3; ++j) {
+        m[i][j] += w * x[i] * x[j];
+      }
+      m[i][3] += w * x[i] * sample.nanoseconds;
+    }
+  }
+
+  // Gaussian elimination with partial pivoting.
+  for (size_t col = 0; col < 3; ++col) {
+    size_t pivot = col;
+    for (size_t row = col + 1; row < 3; ++row) {
+      if (std::fabs(m[row][col]) > std::fabs(m[pivot][col])) {
+        pivot = row;
+      }
+    }
+    if (std::fabs(m[pivot][col]) < std::numeric_limits<double>::min()) {
+      throw std::runtime_error("not enough samples to fit a cost model");
+    }
+    for (size_t k = 0; k < 4; ++k) {
+      std::swap(m[col][k], m[pivot][k]);
+    }
+    for (size_t row = 0; row < 3; ++row) {
+      if (row != col) {
+        const double factor = m[row][col] / m[col][col];
+        for (size_t k = col; k < 4; ++k) {
+          m[row][k] -= factor * m[col][k];
+        }
+      }
+    }
+  }
+
+  CostModel model;
+  model.a = m[0][3] / m[0][0];
+  model.b = m[1][3] / m[1][1];
+  model.c = m[2][3] / m[2][2];
+  return model;
+}
+
+// Sorted list of `length` integers whose gaps are uniform in
+// [1, 2^(bits + 1) - 1], 2^bits on average.
+static std::vector<uint32_t> uniformList(size_t length, unsigned bits, std::mt19937_64& generator) {
+  std::uniform_int_distribution<uint64_t> gap(1, (uint64_t(1) << (bits + 1)) - 1);
+  std::vector<uint32_t> list(length);
+  uint64_t value = 0;
+
+  for (size_t i = 0; i < length; ++i) {
+    list[i] = static_cast<uint32_t>(value);
+    value += gap(generator);
+  }
+
+  return list;
+}
+
+// Sorted list of runs of `clusterLength` consecutive integers, separated by
+// random jumps, with 2^bits per gap on average.
+static std::vector<uint32_t> clusteredList(size_t length, unsigned bits, std::mt19937_64& generator) {
+  const uint64_t meanJump = clusterLength * (uint64_t(1) << bits) - (clusterLength - 1);
+  std::uniform_int_distribution<uint64_t> jump(1, 2 * meanJump - 1);
+  std::vector<uint32_t> list(length);
+  uint64_t value = 0;
+
+  for (size_t i = 0; i < length; ++i) {
+    list[i] = static_cast<uint32_t>(value);
+    value += ((i + 1) % clusterLength == 0) ? jump(generator) : 1;
+  }
+
+  return list;
+}
+
+// Nanoseconds to encode and to decode `list`.
+static void timeList(
+  SIMDCompressionLib::IntegerCODEC& codec,
+  size_t blockSize,
+  std::vector<uint32_t>& list,
+  double& encodeNanoseconds,
+  double& decodeNanoseconds)
+{
+  SIMDCompressionUtil comp(codec, blockSize, list);
+  const size_t repetitions = std::max(size_t(1), minTimedIntegers / list.size());
+
+  encodeNanoseconds = std::numeric_limits<double>::max();
+  decodeNanoseconds = std::numeric_limits<double>::max();
+
+  for (size_t round = 0; round < timingRounds; ++round) {
+    encodeNanoseconds = std::min(encodeNanoseconds, TimeEncode(comp, repetitions) * 1e9);
+    decodeNanoseconds = std::min(decodeNanoseconds, TimeDecode(comp, repetitions) * 1e9);
+  }
+
+  comp.EqualityCheck();
+}
+
+static double percentile(std::vector<double> values, double p) {
+  if (values.empty()) {
+    return 0.0;
+  }
+
+  std::sort(values.begin(), values.end());
+  return values[std::min(values.size() - 1, size_t(p * values.size()))];
+}
+
+static CodecCosts calibrateCodec(
+  const CodecDescriptor& desc,
+  std::vector<std::vector<uint32_t> >& trainingLists,
+  std::vector<std::vector<uint32_t> >& heldOutLists)
+{
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = desc.create();
+  std::vector<CostSample> encodeSamples, decodeSamples;
+  CodecCosts costs;
+
+  for (std::vector<uint32_t>& list : trainingLists) {
+    CostSample sample = {list.size(), BitsPerGap(list), 0.0};
+    double encodeNanoseconds, decodeNanoseconds;
+
+    timeList(*codec, desc.blockSize, list, encodeNanoseconds, decodeNanoseconds);
+
+    sample.nanoseconds = encodeNanoseconds;
+    encodeSamples.push_back(sample);
+    sample.nanoseconds = decodeNanoseconds;
+    decodeSamples.push_back(sample);
+  }
+
+  costs.name = desc.name;
+  costs.blockSize = desc.blockSize;
+  costs.encode = FitCostModel(encodeSamples);
+  costs.decode = FitCostModel(decodeSamples);
+
+  double encodeMeasured = 0, encodePredicted = 0, decodeMeasured = 0, decodePredicted = 0;
+
+  for (std::vector<uint32_t>& list : heldOutLists) {
+    const double bits = BitsPerGap(list);
+    const double predictedEncode = costs.encode.Predict(list.size(), bits);
+    const double predictedDecode = costs.decode.Predict(list.size(), bits);
+    double encodeNanoseconds, decodeNanoseconds;
+
+    timeList(*codec, desc.blockSize, list, encodeNanoseconds, decodeNanoseconds);
+
+    if (encodeNanoseconds > 0) {
+      costs.encodeErrors.push_back(std::fabs(predictedEncode - encodeNanoseconds) / encodeNanoseconds);
+    }
+    if (decodeNanoseconds > 0) {
+      costs.decodeErrors.push_back(std::fabs(predictedDecode - decodeNanoseconds) / decodeNanoseconds);
+    }
+
+    encodeMeasured += encodeNanoseconds;
+    encodePredicted += predictedEncode;
+    decodeMeasured += decodeNanoseconds;
+    decodePredicted += predictedDecode;
+  }
+
+  costs.encodeTotalError = (encodeMeasured > 0) ? (encodePredicted - encodeMeasured) / encodeMeasured : 0.0;
+  costs.decodeTotalError = (decodeMeasured > 0) ? (decodePredicted - decodeMeasured) / decodeMeasured : 0.0;
+  return costs;
+}
+
+static void writeModel(
+  std::ofstream& outFile,
+  const std::string& name,
+  const CostModel& model,
+  const std::vector<double>& errors,
+  double totalError)
+{
+  outFile << "      \"" << name << "\": {\"a\": " << model.a << ", \"b\": " << model.b << ", \"c\": " << model.c
+    << ", \"medianError\": " << percentile(errors, 0.5) << ", \"p90Error\": " << percentile(errors, 0.9)
+    << ", \"totalError\": " << totalError << "}";
+}
+
+static void writeJson(
+  const std::string& outputPath,
+  const std::vector<CodecCosts>& results,
+  size_t numTrainingLists,
+  size_t numHeldOutLists)
+{
+  std::ofstream outFile(outputPath, std::ios::out | std::ios::trunc);
+
+  if (outFile.fail()) {
+    throw std::runtime_error("Failed to open '" + outputPath + "'");
+  }
+
+  outFile << std::setprecision(6);
+  outFile << "{" << std::endl;
+  outFile << "  \"model\": \"ns = a + b * n + c * n * bitsPerGap\"," << std::endl;
+  outFile << "  \"bitsPerGap\": \"log2(1 + (last - first) / n)\"," << std::endl;
+  outFile << "  \"trainingLists\": " << numTrainingLists << "," << std::endl;
+  outFile << "  \"heldOutLists\": " << numHeldOutLists << "," << std::endl;
+  outFile << "  \"codecs\": [" << std::endl;
+
+  for (size_t i = 0; i < results.size(); ++i) {
+    const CodecCosts& costs = results[i];
+
+    outFile << "    {" << std::endl;
+    outFile << "      \"name\": \"" << costs.name << "\"," << std::endl;
+    outFile << "      \"blockSize\": " << costs.blockSize << "," << std::endl;
+    writeModel(outFile, "encode", costs.encode, costs.encodeErrors, costs.encodeTotalError);
+    outFile << "," << std::endl;
+    writeModel(outFile, "decode", costs.decode, costs.decodeErrors, costs.decodeTotalError);
+    outFile << std::endl << "    }" << (i + 1 < results.size() ? "," : "") << std::endl;
+  }
+
+  outFile << "  ]" << std::endl;
+  outFile << "}" << std::endl;
+
+  outFile.close();
+  if (outFile.fail()) {
+    throw std::runtime_error("Failed to write '" + outputPath + "'");
+  }
+}
+
+static void printModel(const std::string& name, const std::string& operation, const CostModel& model,
+  const std::vector<double>& errors, double totalError)
+{
+  std::cout << std::left << std::setw(28) << name << std::setw(8) << operation << std::right
+    << std::fixed << std::setprecision(1) << std::setw(10) << model.a
+    << std::setprecision(3) << std::setw(10) << model.b << std::setw(10) << model.c
+    << std::setprecision(1) << std::setw(9) << 100 * percentile(errors, 0.5) << "%"
+    << std::setw(9) << 100 * percentile(errors, 0.9) << "%"
+    << std::setw(9) << 100 * totalError << "%" << std::endl;
+}
+
+void CalibrateCostModels(const std::string& outputPath) {
+  std::vector<std::vector<uint32_t> > trainingLists, heldOutLists;
+  std::mt19937_64 generator(5);
+
+  for (size_t length : syntheticLengths) {
+    for (unsigned bits : syntheticBits) {
+      // Both kinds of lists stay below length * 2^(bits + 1).
+      if (double(length) * std::ldexp(2.0, bits) >= std::ldexp(1.0, 32)) {
+        continue;
+      }
+      trainingLists.push_back(uniformList(length, bits, generator));
+      trainingLists.push_back(clusteredList(length, bits, generator));
+    }
+  }
+
+  const size_t numSyntheticLists = trainingLists.size();
+
+  // The lists of every stratum go alternately to the training set and to the
+  // held-out set.
+  StratifiedSample sample;
+  sample.Build(Gov2SortedPath(), gov2SampleFraction, 5);
+
+  for (const StratifiedSample::Stratum& stratum : sample.Strata()) {
+    for (size_t i = 0; i < stratum.sampled.size(); ++i) {
+      std::vector<uint32_t>& list = sample.Lists()[stratum.sampled[i]];
+
+      if (!list.empty()) {
+        ((i % 2 == 0) ? trainingLists : heldOutLists).push_back(list);
+      }
+    }
+  }
+
+  std::cout << "Training lists: " << numSyntheticLists << " synthetic, "
+    << trainingLists.size() - numSyntheticLists << " gov2; held-out gov2 lists: "
+    << heldOutLists.size() << std::endl << std::endl;
+
+  std::vector<const CodecDescriptor *> codecs(1, &VTEncCodecDescriptor());
+  for (const CodecDescriptor& desc : CodecTable()) {
+    codecs.push_back(&desc);
+  }
+
+  std::cout << std::left << std::setw(28) << "Codec" << std::setw(8) << "Op"
+    << std::right << std::setw(10) << "a (ns)" << std::setw(10) << "b (ns)" << std::setw(10) << "c (ns)"
+    << std::setw(10) << "Median" << std::setw(10) << "P90" << std::setw(10) << "Total" << std::endl;
+
+  std::vector<CodecCosts> results;
+
+  for (const CodecDescriptor *desc : codecs) {
+    if (!desc->create()) {
+      continue;
+    }
+
+    results.push_back(calibrateCodec(*desc, trainingLists, heldOutLists));
+
+    const CodecCosts& costs = results.back();
+    printModel(costs.name, "encode", costs.encode, costs.encodeErrors, costs.encodeTotalError);
+    printModel(costs.name, "decode", costs.decode, costs.decodeErrors, costs.decodeTotalError);
+  }
+
+  writeJson(outputPath, results, trainingLists.size(), heldOutLists.size());
+
+  std::cout << std::endl << "Cost models written to " << outputPath << std::endl;
+}
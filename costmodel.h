@@ -0,0 +1,48 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#ifndef INTCOMPBENCH_COSTMODEL_H_
+#define INTCOMPBENCH_COSTMODEL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Average number of bits of the gaps of a sorted list: log2(1 + range / n),
+// where range is the last integer minus the first one. It only needs the
+// length and the first and last integers, which a query planner knows
+// before decoding the list.
+double BitsPerGap(const std::vector<uint32_t>& list);
+
+// Estimated time, in nanoseconds, to encode or decode a list of n integers
+// with `bitsPerGap` bits per gap: a + b * n + c * n * bitsPerGap.
+struct CostModel {
+  double a;
+  double b;
+  double c;
+
+  double Predict(size_t n, double bitsPerGap) const { return a + (b + c * bitsPerGap) * n; }
+};
+
+// Time measured for one list.
+struct CostSample {
+  size_t length;
+  double bitsPerGap;
+  double nanoseconds;
+};
+
+// Fits a CostModel to the samples by least squares on the relative error,
+// so that short and long lists count the same.
+CostModel FitCostModel(const std::vector<CostSample>& samples);
+
+// Times encoding and decoding with VTEnc and every codec of the table on
+// synthetic lists (uniform and clustered gaps) of a range of lengths and
+// bits per gap, and on half of a stratified sample of the gov2 lists, and
+// fits a CostModel to each. The other half of the gov2 sample is held out to
+// check the predictions. Prints the models and their errors, and writes
+// them as JSON to `outputPath`.
+void CalibrateCostModels(const std::string& outputPath);
+
+#endif // INTCOMPBENCH_COSTMODEL_H_
@@ -0,0 +1,184 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#include "energy.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+static const std::string powercapDirectory = std::string("/sys/class/powercap");
+
+std::vector<EnergyMeter::Zone> EnergyMeter::_zones = std::vector<EnergyMeter::Zone>();
+bool EnergyMeter::_zonesLoaded = false;
+
+static bool isPackageZone(const std::string& name) {
+  // Package zones are named "intel-rapl:N". Their subzones ("intel-rapl:N:M")
+  // are already accounted for in the package counter, except for DRAM.
+  const std::string prefix = std::string("intel-rapl:");
+
+  return name.compare(0, prefix.length(), prefix) == 0 &&
+    name.find(':', prefix.length()) == std::string::npos;
+}
+
+static bool isSubZone(const std::string& name) {
+  const std::string prefix = std::string("intel-rapl:");
+
+  return name.compare(0, prefix.length(), prefix) == 0 &&
+    name.find(':', prefix.length()) != std::string::npos;
+}
+
+static std::string readZoneName(const std::string& zoneDirectory) {
+  std::ifstream inFile(zoneDirectory + std::string("/name"));
+  std::string name;
+
+  inFile >> name;
+
+  return name;
+}
+
+bool EnergyMeter::readCounter(const std::string& fileName, uint64_t& value) {
+  std::ifstream inFile(fileName);
+
+  if (inFile.fail()) {
+    return false;
+  }
+
+  return static_cast<bool>(inFile >> value);
+}
+
+bool EnergyMeter::readEnergy(const Zone& zone, uint64_t& value) {
+  char buffer[32];
+  const ssize_t length = pread(zone.energyFd, buffer, sizeof(buffer) - 1, 0);
+
+  if (length <= 0) {
+    return false;
+  }
+
+  buffer[length] = '\0';
+  value = std::strtoull(buffer, NULL, 10);
+
+  return true;
+}
+
+void EnergyMeter::loadZones() {
+  DIR *dir = opendir(powercapDirectory.c_str());
+
+  _zonesLoaded = true;
+
+  if (dir == NULL) {
+    return;
+  }
+
+  struct dirent *entry;
+  std::vector<std::string> names;
+
+  while ((entry = readdir(dir)) != NULL) {
+    names.push_back(std::string(entry->d_name));
+  }
+
+  closedir(dir);
+
+  std::sort(names.begin(), names.end());
+
+  for (const std::string& name : names) {
+    const std::string zoneDirectory = powercapDirectory + "/" + name;
+
+    if (!isPackageZone(name) && !(isSubZone(name) && readZoneName(zoneDirectory) == "dram")) {
+      continue;
+    }
+
+    Zone zone;
+    uint64_t value;
+
+    zone.energyFile = zoneDirectory + std::string("/energy_uj");
+
+    // Since Linux 5.10, reading the counters requires root privileges. Zones
+    // that cannot be read are left out.
+    if (!readCounter(zone.energyFile, value)) {
+      continue;
+    }
+
+    // Without the range of the counter, a wraparound would give garbage.
+    if (!readCounter(zoneDirectory + std::string("/max_energy_range_uj"), zone.maxEnergyRange) ||
+        zone.maxEnergyRange == 0) {
+      continue;
+    }
+
+    zone.energyFd = open(zone.energyFile.c_str(), O_RDONLY);
+    if (zone.energyFd == -1) {
+      continue;
+    }
+
+    _zones.push_back(zone);
+  }
+}
+
+EnergyMeter::EnergyMeter(): _microJoules(0), _running(false) {
+  if (!_zonesLoaded) {
+    loadZones();
+  }
+
+  _start.resize(_zones.size(), 0);
+}
+
+bool EnergyMeter::Available() {
+  if (!_zonesLoaded) {
+    loadZones();
+  }
+
+  return !_zones.empty();
+}
+
+void EnergyMeter::Start() {
+  _microJoules = 0;
+  _running = false;
+  Resume();
+}
+
+void EnergyMeter::Pause() {
+  if (_running) {
+    _microJoules += microJoulesSinceResume();
+    _running = false;
+  }
+}
+
+void EnergyMeter::Resume() {
+  for (size_t i = 0; i < _zones.size(); ++i) {
+    readEnergy(_zones[i], _start[i]);
+  }
+
+  _running = true;
+}
+
+double EnergyMeter::ElapsedJoules() {
+  const uint64_t microJoules = _microJoules + (_running ? microJoulesSinceResume() : 0);
+
+  return static_cast<double>(microJoules) / 1e6;
+}
+
+uint64_t EnergyMeter::microJoulesSinceResume() {
+  uint64_t microJoules = 0;
+
+  for (size_t i = 0; i < _zones.size(); ++i) {
+    uint64_t end = _start[i];
+
+    readEnergy(_zones[i], end);
+
+    if (end >= _start[i]) {
+      microJoules += end - _start[i];
+    } else {
+      // The counter wrapped around since the meter was resumed.
+      microJoules += (_zones[i].maxEnergyRange - _start[i]) + end;
+    }
+  }
+
+  return microJoules;
+}
@@ -0,0 +1,54 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#ifndef INTCOMPBENCH_ENERGY_H_
+#define INTCOMPBENCH_ENERGY_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Measures the energy consumed by the machine through the RAPL counters that
+// Linux exposes in the powercap framework (/sys/class/powercap/intel-rapl:*).
+// The package zones and their DRAM subzones are added up; zones whose
+// max_energy_range_uj is unknown are left out, as their wraparounds cannot be
+// accounted for. When the interface is missing or its counters cannot be
+// read, the meter is not available and no measurement is reported.
+class EnergyMeter {
+private:
+  struct Zone {
+    std::string energyFile;
+    // Kept open, as the counters are read every time the timer is paused.
+    int energyFd;
+    uint64_t maxEnergyRange;
+  };
+
+  static std::vector<Zone> _zones;
+  static bool _zonesLoaded;
+
+  std::vector<uint64_t> _start;
+  uint64_t _microJoules;
+  bool _running;
+
+  static void loadZones();
+  static bool readCounter(const std::string& fileName, uint64_t& value);
+  static bool readEnergy(const Zone& zone, uint64_t& value);
+  uint64_t microJoulesSinceResume();
+
+public:
+  EnergyMeter();
+
+  static bool Available();
+
+  // Starts a new measurement.
+  void Start();
+  // Leaves the energy consumed from Pause() to Resume() out of the
+  // measurement.
+  void Pause();
+  void Resume();
+  // Energy consumed while the meter was running since Start().
+  double ElapsedJoules();
+};
+
+#endif // INTCOMPBENCH_ENERGY_H_
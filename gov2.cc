@@ -3,25 +3,23 @@
 // See LICENSE file in the project root for full license information.
 
 #include <algorithm>
-#include <fstream>
+#include <chrono>
+#include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "common.h"
+#include "smalllist.h"
 
 #include "benchmark/include/benchmark/benchmark.h"
-#include "SIMDCompressionAndIntersection/include/binarypacking.h"
-#include "SIMDCompressionAndIntersection/include/fastpfor.h"
+#include "SIMDCompressionAndIntersection/include/codecs.h"
 #include "SIMDCompressionAndIntersection/include/variablebyte.h"
-#include "SIMDCompressionAndIntersection/include/varintgb.h"
 #include "VTEnc/vtenc.h"
 
 class Gov2SortedDataSet : public benchmark::Fixture {
 private:
-  std::ifstream _inFile;
-  char _buffer[4096];
-  size_t _bufferCount;
-  size_t _bufferOffset;
+  Gov2SortedFile _file;
 
 public:
   void SetUp(const ::benchmark::State& state) {}
@@ -29,88 +27,53 @@ public:
   void TearDown(const ::benchmark::State& state) {}
 
   void openFile() {
-    const std::string fileName = GlobalState::dataDirectory + std::string("/gov2.sorted");
-
-    _inFile.open(fileName, std::ios::in | std::ios::binary);
-
-    if (_inFile.fail()) {
-      throw std::logic_error("Failed to open '" + fileName + "'");
-    }
-
-    _bufferCount = 0;
-    _bufferOffset = 0;
+    _file.Open(Gov2SortedPath());
   }
 
   void closeFile() {
-    _inFile.close();
-  }
-
-  void refreshBuffer() {
-    // Here, it is assumed that the file has a size multiple of 4, so there is no
-    // left bytes to copy over when refreshing the buffer.
-    _inFile.read(_buffer, sizeof(_buffer));
-    if (_inFile.eof()) {
-      throw "End of file";
-    }
-    _bufferCount = _inFile.gcount();
-    _bufferOffset = 0;
-  }
-
-  uint32_t readNextUint32() {
-    if ((_bufferCount - _bufferOffset) < 4) {
-      refreshBuffer();
-    }
-    uint32_t value;
-    std::memcpy(&value, &(_buffer[_bufferOffset]), sizeof(value));
-    _bufferOffset += 4;
-    return value;
+    _file.Close();
   }
 
   bool loadNextSet(std::vector<uint32_t>& data) {
-    data.clear();
-
-    try {
-      uint32_t len = readNextUint32();
-      for (size_t i = 0; i < len; ++i) {
-        data.push_back(readNextUint32());
-      }
-    } catch (...) {
-      return false;
-    }
-
-    return true;
+    return _file.LoadNextSet(data);
   }
 };
 
+typedef std::function<void(
+  std::vector<uint32_t>& data,
+  benchmark::State& state,
+  CompressionStats& stats)> Gov2SetFunction;
+
 static void benchmarkGov2SortedDataSet(
   Gov2SortedDataSet* obj,
   benchmark::State& state,
-  void (*func)(
-    std::vector<uint32_t>& data,
-    benchmark::State& state,
-    CompressionStats& stats
-  ))
+  Gov2SetFunction func)
 {
+  if (GlobalState::gov2SampleFraction > 0) {
+    state.SkipWithError("whole file skipped with --gov2-sample");
+    return;
+  }
+
   CompressionStats stats(state);
   std::vector<uint32_t> data;
 
   for (auto _ : state) {
-    state.PauseTiming();
+    stats.PauseTiming();
     stats.Reset();
     obj->openFile();
-    state.ResumeTiming();
+    stats.ResumeTiming();
 
     while (1) {
-      state.PauseTiming();
+      stats.PauseTiming();
       if (!obj->loadNextSet(data)) break;
-      state.ResumeTiming();
+      stats.ResumeTiming();
 
       func(data, state, stats);
     }
 
-    state.PauseTiming();
+    // The timer is still paused after the last call to loadNextSet().
     obj->closeFile();
-    state.ResumeTiming();
+    stats.ResumeTiming();
   }
 
   stats.SetFinalStats();
@@ -121,16 +84,16 @@ static void encodeWithCopy(
   benchmark::State& state,
   CompressionStats& stats)
 {
-  state.PauseTiming();
+  stats.PauseTiming();
   std::vector<uint32_t> copyTo(data.size());
-  state.ResumeTiming();
+  stats.ResumeTiming();
 
   std::copy(data.begin(), data.end(), copyTo.begin());
 
-  state.PauseTiming();
+  stats.PauseTiming();
   stats.UpdateInputLengthInBytes(data.size() * sizeof(uint32_t));
   stats.UpdateEncodedLengthInBytes(data.size() * sizeof(uint32_t));
-  state.ResumeTiming();
+  stats.ResumeTiming();
 }
 
 static void encodeWithVTEnc(
@@ -138,22 +101,22 @@ static void encodeWithVTEnc(
   benchmark::State& state,
   CompressionStats& stats)
 {
-  state.PauseTiming();
-  std::vector<uint8_t> encoded(vtenc_max_encoded_size32(data.size()));
+  stats.PauseTiming();
+  HugePageVector<uint8_t> encoded(vtenc_max_encoded_size32(data.size()));
   vtenc *handler = vtenc_create();
   assert(handler != NULL);
   vtenc_config(handler, VTENC_CONFIG_ALLOW_REPEATED_VALUES, 0);
   vtenc_config(handler, VTENC_CONFIG_SKIP_FULL_SUBTREES, 1);
   vtenc_config(handler, VTENC_CONFIG_MIN_CLUSTER_LENGTH, static_cast<size_t>(state.range(0)));
-  state.ResumeTiming();
+  stats.ResumeTiming();
 
   vtenc_encode32(handler, data.data(), data.size(), encoded.data(), encoded.size());
 
-  state.PauseTiming();
+  stats.PauseTiming();
   stats.UpdateInputLengthInBytes(data.size() * sizeof(uint32_t));
   stats.UpdateEncodedLengthInBytes(vtenc_encoded_size(handler));
   vtenc_destroy(handler);
-  state.ResumeTiming();
+  stats.ResumeTiming();
 }
 
 static void decodeWithVTEnc(
@@ -161,8 +124,8 @@ static void decodeWithVTEnc(
   benchmark::State& state,
   CompressionStats& stats)
 {
-  state.PauseTiming();
-  std::vector<uint8_t> encoded(vtenc_max_encoded_size32(data.size()));
+  stats.PauseTiming();
+  HugePageVector<uint8_t> encoded(vtenc_max_encoded_size32(data.size()));
   vtenc *handler = vtenc_create();
   assert(handler != NULL);
   vtenc_config(handler, VTENC_CONFIG_ALLOW_REPEATED_VALUES, 0);
@@ -170,19 +133,19 @@ static void decodeWithVTEnc(
   vtenc_config(handler, VTENC_CONFIG_MIN_CLUSTER_LENGTH, static_cast<size_t>(state.range(0)));
   vtenc_encode32(handler, data.data(), data.size(), encoded.data(), encoded.size());
   size_t encodedLength = vtenc_encoded_size(handler);
-  std::vector<uint32_t> decoded(data.size());
-  state.ResumeTiming();
+  HugePageVector<uint32_t> decoded(data.size());
+  stats.ResumeTiming();
 
   vtenc_decode32(handler, encoded.data(), encodedLength, decoded.data(), decoded.size());
 
-  state.PauseTiming();
-  if (data != decoded) {
+  stats.PauseTiming();
+  if (!std::equal(data.begin(), data.end(), decoded.begin())) {
     throw std::logic_error("equality check failed");
   }
   stats.UpdateInputLengthInBytes(data.size() * sizeof(uint32_t));
   stats.UpdateEncodedLengthInBytes(encodedLength);
   vtenc_destroy(handler);
-  state.ResumeTiming();
+  stats.ResumeTiming();
 }
 
 static void encodeWithSIMDCompressionCodec(
@@ -192,16 +155,16 @@ static void encodeWithSIMDCompressionCodec(
   benchmark::State& state,
   CompressionStats& stats)
 {
-  state.PauseTiming();
+  stats.PauseTiming();
   SIMDCompressionUtil comp(codec, blockSize, data);
-  state.ResumeTiming();
+  stats.ResumeTiming();
 
   comp.Encode();
 
-  state.PauseTiming();
+  stats.PauseTiming();
   stats.UpdateInputLengthInBytes(comp.InputLength() * sizeof(uint32_t));
   stats.UpdateEncodedLengthInBytes(comp.EncodedLength() * sizeof(uint32_t));
-  state.ResumeTiming();
+  stats.ResumeTiming();
 }
 
 static void decodeWithSIMDCompressionCodec(
@@ -211,164 +174,221 @@ static void decodeWithSIMDCompressionCodec(
   benchmark::State& state,
   CompressionStats& stats)
 {
-  state.PauseTiming();
+  stats.PauseTiming();
   SIMDCompressionUtil comp(codec, blockSize, data);
   comp.Encode();
-  state.ResumeTiming();
+  stats.ResumeTiming();
 
   comp.Decode();
 
-  state.PauseTiming();
+  stats.PauseTiming();
   comp.EqualityCheck();
   stats.UpdateInputLengthInBytes(comp.InputLength() * sizeof(uint32_t));
   stats.UpdateEncodedLengthInBytes(comp.EncodedLength() * sizeof(uint32_t));
-  state.ResumeTiming();
+  stats.ResumeTiming();
 }
 
-static void encodeWithDeltaVariableByte(
-  std::vector<uint32_t>& data,
-  benchmark::State& state,
-  CompressionStats& stats)
-{
-  SIMDCompressionLib::VByte<true> codec;
-  encodeWithSIMDCompressionCodec(codec, 1, data, state, stats);
+BENCHMARK_F(Gov2SortedDataSet, Copy)(benchmark::State& state) {
+  benchmarkGov2SortedDataSet(this, state, encodeWithCopy);
 }
 
-static void decodeWithDeltaVariableByte(
-  std::vector<uint32_t>& data,
-  benchmark::State& state,
-  CompressionStats& stats)
-{
-  SIMDCompressionLib::VByte<true> codec;
-  decodeWithSIMDCompressionCodec(codec, 1, data, state, stats);
+BENCHMARK_DEFINE_F(Gov2SortedDataSet, VTEncEncode)(benchmark::State& state) {
+  benchmarkGov2SortedDataSet(this, state, encodeWithVTEnc);
 }
 
-static void encodeWithDeltaVarIntGB(
-  std::vector<uint32_t>& data,
-  benchmark::State& state,
-  CompressionStats& stats)
-{
-  SIMDCompressionLib::VarIntGB<true> codec;
-  encodeWithSIMDCompressionCodec(codec, 1, data, state, stats);
-}
+BENCHMARK_REGISTER_F(Gov2SortedDataSet, VTEncEncode)
+  ->RangeMultiplier(2)->Range(1, 1<<8);
 
-static void decodeWithDeltaVarIntGB(
-  std::vector<uint32_t>& data,
-  benchmark::State& state,
-  CompressionStats& stats)
-{
-  SIMDCompressionLib::VarIntGB<true> codec;
-  decodeWithSIMDCompressionCodec(codec, 1, data, state, stats);
+BENCHMARK_DEFINE_F(Gov2SortedDataSet, VTEncDecode)(benchmark::State& state) {
+  benchmarkGov2SortedDataSet(this, state, decodeWithVTEnc);
 }
 
-static void encodeWithDeltaBinaryPacking(
-  std::vector<uint32_t>& data,
-  benchmark::State& state,
-  CompressionStats& stats)
-{
-  SIMDCompressionLib::BinaryPacking<SIMDCompressionLib::BasicBlockPacker> codec;
-  encodeWithSIMDCompressionCodec(codec, codec.BlockSize, data, state, stats);
-}
+BENCHMARK_REGISTER_F(Gov2SortedDataSet, VTEncDecode)
+  ->RangeMultiplier(2)->Range(1, 1<<8);
 
-static void decodeWithDeltaBinaryPacking(
-  std::vector<uint32_t>& data,
-  benchmark::State& state,
-  CompressionStats& stats)
-{
-  SIMDCompressionLib::BinaryPacking<SIMDCompressionLib::BasicBlockPacker> codec;
-  decodeWithSIMDCompressionCodec(codec, codec.BlockSize, data, state, stats);
+static void benchmarkCodecEncode(Gov2SortedDataSet* obj, const CodecDescriptor& desc, benchmark::State& state) {
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = desc.create();
+  if (!codec) {
+    state.SkipWithError("codec not available");
+    return;
+  }
+  benchmarkGov2SortedDataSet(obj, state,
+    [&](std::vector<uint32_t>& data, benchmark::State& state, CompressionStats& stats) {
+      encodeWithSIMDCompressionCodec(*codec, desc.blockSize, data, state, stats);
+    });
 }
 
-static void encodeWithDeltaFastPFor128(
-  std::vector<uint32_t>& data,
-  benchmark::State& state,
-  CompressionStats& stats)
-{
-  SIMDCompressionLib::FastPFor<4, true> codec;
-  encodeWithSIMDCompressionCodec(codec, codec.BlockSize, data, state, stats);
+static void benchmarkCodecDecode(Gov2SortedDataSet* obj, const CodecDescriptor& desc, benchmark::State& state) {
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = desc.create();
+  if (!codec) {
+    state.SkipWithError("codec not available");
+    return;
+  }
+  benchmarkGov2SortedDataSet(obj, state,
+    [&](std::vector<uint32_t>& data, benchmark::State& state, CompressionStats& stats) {
+      decodeWithSIMDCompressionCodec(*codec, desc.blockSize, data, state, stats);
+    });
 }
 
-static void decodeWithDeltaFastPFor128(
-  std::vector<uint32_t>& data,
-  benchmark::State& state,
-  CompressionStats& stats)
-{
-  SIMDCompressionLib::FastPFor<4, true> codec;
-  encodeWithSIMDCompressionCodec(codec, codec.BlockSize, data, state, stats);
+// Share of the encoded bytes and of the time that goes to the fallback codec,
+// that is, to the lists below the small-list threshold and to the tails that
+// do not fill a whole block.
+struct FallbackStats {
+  double encodedBytes;
+  double tailEncodedBytes;
+  double seconds;
+  double tailSeconds;
+  size_t lists;
+
+  FallbackStats(): encodedBytes(0), tailEncodedBytes(0), seconds(0), tailSeconds(0), lists(0) {}
+
+  void SetCounters(benchmark::State& state) {
+    state.counters["lists"] = benchmark::Counter(lists, benchmark::Counter::kAvgIterations);
+    state.counters["fallbackBytesShare"] = (encodedBytes > 0) ? (tailEncodedBytes / encodedBytes) : 0;
+    state.counters["fallbackTimeShare"] = (seconds > 0) ? (tailSeconds / seconds) : 0;
+  }
+};
+
+// Bucket benchmarks take three arguments: the list length range [min, max)
+// and the small-list threshold. A threshold of 0 keeps VByte<true> as the
+// fallback codec; any other value sends the tails, and the lists shorter than
+// the threshold, to DeltaBitPacking.
+static bool inBucket(const std::vector<uint32_t>& data, const benchmark::State& state) {
+  return data.size() >= static_cast<size_t>(state.range(0)) &&
+    data.size() < static_cast<size_t>(state.range(1));
 }
 
-static void encodeWithDeltaFastPFor256(
+static void encodeBucketWithSIMDCompressionCodec(
+  SIMDCompressionLib::IntegerCODEC& codec,
+  size_t blockSize,
   std::vector<uint32_t>& data,
   benchmark::State& state,
-  CompressionStats& stats)
+  CompressionStats& stats,
+  FallbackStats& fallbackStats)
 {
-  SIMDCompressionLib::FastPFor<8, true> codec;
-  encodeWithSIMDCompressionCodec(codec, codec.BlockSize, data, state, stats);
+  if (!inBucket(data, state)) return;
+
+  stats.PauseTiming();
+  SIMDCompressionLib::VByte<true> vbyteCodec;
+  DeltaBitPacking bitPackingCodec;
+  size_t threshold = static_cast<size_t>(state.range(2));
+  SIMDCompressionLib::IntegerCODEC& fallbackCodec = (threshold == 0) ?
+    static_cast<SIMDCompressionLib::IntegerCODEC&>(vbyteCodec) : bitPackingCodec;
+  SIMDCompressionUtil comp(codec, blockSize, data, fallbackCodec, threshold);
+  stats.ResumeTiming();
+
+  comp.EncodeBlocks();
+  comp.EncodeTail();
+
+  stats.PauseTiming();
+  // The split between the blocks and the tail is timed again, out of the
+  // benchmark timer, so that reading the clock does not weigh on short lists.
+  comp.Reset();
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  comp.EncodeBlocks();
+  double blockSeconds = SecondsSince(start);
+  start = std::chrono::steady_clock::now();
+  comp.EncodeTail();
+  double tailSeconds = SecondsSince(start);
+  stats.UpdateInputLengthInBytes(comp.InputLength() * sizeof(uint32_t));
+  stats.UpdateEncodedLengthInBytes(comp.EncodedLength() * sizeof(uint32_t));
+  fallbackStats.encodedBytes += comp.EncodedLength() * sizeof(uint32_t);
+  fallbackStats.tailEncodedBytes += comp.TailEncodedLength() * sizeof(uint32_t);
+  fallbackStats.seconds += blockSeconds + tailSeconds;
+  fallbackStats.tailSeconds += tailSeconds;
+  fallbackStats.lists++;
+  stats.ResumeTiming();
 }
 
-static void decodeWithDeltaFastPFor256(
+static void decodeBucketWithSIMDCompressionCodec(
+  SIMDCompressionLib::IntegerCODEC& codec,
+  size_t blockSize,
   std::vector<uint32_t>& data,
   benchmark::State& state,
-  CompressionStats& stats)
+  CompressionStats& stats,
+  FallbackStats& fallbackStats)
 {
-  SIMDCompressionLib::FastPFor<8, true> codec;
-  encodeWithSIMDCompressionCodec(codec, codec.BlockSize, data, state, stats);
-}
-
-BENCHMARK_F(Gov2SortedDataSet, Copy)(benchmark::State& state) {
-  benchmarkGov2SortedDataSet(this, state, encodeWithCopy);
-}
-
-BENCHMARK_DEFINE_F(Gov2SortedDataSet, VTEncEncode)(benchmark::State& state) {
-  benchmarkGov2SortedDataSet(this, state, encodeWithVTEnc);
-}
-
-BENCHMARK_REGISTER_F(Gov2SortedDataSet, VTEncEncode)
-  ->RangeMultiplier(2)->Range(1, 1<<8);
-
-BENCHMARK_DEFINE_F(Gov2SortedDataSet, VTEncDecode)(benchmark::State& state) {
-  benchmarkGov2SortedDataSet(this, state, decodeWithVTEnc);
-}
+  if (!inBucket(data, state)) return;
+
+  stats.PauseTiming();
+  SIMDCompressionLib::VByte<true> vbyteCodec;
+  DeltaBitPacking bitPackingCodec;
+  size_t threshold = static_cast<size_t>(state.range(2));
+  SIMDCompressionLib::IntegerCODEC& fallbackCodec = (threshold == 0) ?
+    static_cast<SIMDCompressionLib::IntegerCODEC&>(vbyteCodec) : bitPackingCodec;
+  SIMDCompressionUtil comp(codec, blockSize, data, fallbackCodec, threshold);
+  comp.Encode();
+  stats.ResumeTiming();
 
-BENCHMARK_REGISTER_F(Gov2SortedDataSet, VTEncDecode)
-  ->RangeMultiplier(2)->Range(1, 1<<8);
+  comp.DecodeBlocks();
+  comp.DecodeTail();
 
-BENCHMARK_F(Gov2SortedDataSet, DeltaVariableByteEncode)(benchmark::State& state) {
-  benchmarkGov2SortedDataSet(this, state, encodeWithDeltaVariableByte);
+  stats.PauseTiming();
+  comp.EqualityCheck();
+  // As when encoding, the split is timed out of the benchmark timer.
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  comp.DecodeBlocks();
+  double blockSeconds = SecondsSince(start);
+  start = std::chrono::steady_clock::now();
+  comp.DecodeTail();
+  double tailSeconds = SecondsSince(start);
+  stats.UpdateInputLengthInBytes(comp.InputLength() * sizeof(uint32_t));
+  stats.UpdateEncodedLengthInBytes(comp.EncodedLength() * sizeof(uint32_t));
+  fallbackStats.encodedBytes += comp.EncodedLength() * sizeof(uint32_t);
+  fallbackStats.tailEncodedBytes += comp.TailEncodedLength() * sizeof(uint32_t);
+  fallbackStats.seconds += blockSeconds + tailSeconds;
+  fallbackStats.tailSeconds += tailSeconds;
+  fallbackStats.lists++;
+  stats.ResumeTiming();
 }
 
-BENCHMARK_F(Gov2SortedDataSet, DeltaVariableByteDecode)(benchmark::State& state) {
-  benchmarkGov2SortedDataSet(this, state, decodeWithDeltaVariableByte);
+static void benchmarkCodecBucketEncode(Gov2SortedDataSet* obj, const CodecDescriptor& desc, benchmark::State& state) {
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = desc.create();
+  FallbackStats fallbackStats;
+  benchmarkGov2SortedDataSet(obj, state,
+    [&](std::vector<uint32_t>& data, benchmark::State& state, CompressionStats& stats) {
+      encodeBucketWithSIMDCompressionCodec(*codec, desc.blockSize, data, state, stats, fallbackStats);
+    });
+  fallbackStats.SetCounters(state);
 }
 
-BENCHMARK_F(Gov2SortedDataSet, DeltaVarIntGBEncode)(benchmark::State& state) {
-  benchmarkGov2SortedDataSet(this, state, encodeWithDeltaVarIntGB);
+static void benchmarkCodecBucketDecode(Gov2SortedDataSet* obj, const CodecDescriptor& desc, benchmark::State& state) {
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = desc.create();
+  FallbackStats fallbackStats;
+  benchmarkGov2SortedDataSet(obj, state,
+    [&](std::vector<uint32_t>& data, benchmark::State& state, CompressionStats& stats) {
+      decodeBucketWithSIMDCompressionCodec(*codec, desc.blockSize, data, state, stats, fallbackStats);
+    });
+  fallbackStats.SetCounters(state);
 }
 
-BENCHMARK_F(Gov2SortedDataSet, DeltaVarIntGBDecode)(benchmark::State& state) {
-  benchmarkGov2SortedDataSet(this, state, decodeWithDeltaVarIntGB);
-}
+static void registerBucketBenchmark(benchmark::internal::Benchmark* b) {
+  const int64_t buckets[][2] = {{1, 128}, {128, 1024}, {1024, 1 << 14}, {1 << 14, 1 << 30}};
 
-BENCHMARK_F(Gov2SortedDataSet, DeltaBinaryPackingEncode)(benchmark::State& state) {
-  benchmarkGov2SortedDataSet(this, state, encodeWithDeltaBinaryPacking);
+  for (const int64_t *bucket : buckets) {
+    for (int64_t threshold : {0, 256}) {
+      b->Args({bucket[0], bucket[1], threshold});
+    }
+  }
 }
 
-BENCHMARK_F(Gov2SortedDataSet, DeltaBinaryPackingDecode)(benchmark::State& state) {
-  benchmarkGov2SortedDataSet(this, state, decodeWithDeltaBinaryPacking);
-}
+static bool registerCodecBenchmarks() {
+  RegisterCodecBenchmarks<Gov2SortedDataSet>("Gov2SortedDataSet", "Encode", benchmarkCodecEncode);
+  RegisterCodecBenchmarks<Gov2SortedDataSet>("Gov2SortedDataSet", "Decode", benchmarkCodecDecode);
 
-BENCHMARK_F(Gov2SortedDataSet, DeltaFastPFor128Encode)(benchmark::State& state) {
-  benchmarkGov2SortedDataSet(this, state, encodeWithDeltaFastPFor128);
-}
+  // Only the block codecs have a fallback codec to break down.
+  for (const CodecDescriptor& codec : CodecTable()) {
+    if (codec.blockSize == 1) continue;
 
-BENCHMARK_F(Gov2SortedDataSet, DeltaFastPFor128Decode)(benchmark::State& state) {
-  benchmarkGov2SortedDataSet(this, state, decodeWithDeltaFastPFor128);
-}
+    registerBucketBenchmark(benchmark::internal::RegisterBenchmarkInternal(
+      new CodecBenchmark<Gov2SortedDataSet>(
+        "Gov2SortedDataSet/" + codec.name + "BucketEncode", codec, benchmarkCodecBucketEncode)));
+    registerBucketBenchmark(benchmark::internal::RegisterBenchmarkInternal(
+      new CodecBenchmark<Gov2SortedDataSet>(
+        "Gov2SortedDataSet/" + codec.name + "BucketDecode", codec, benchmarkCodecBucketDecode)));
+  }
 
-BENCHMARK_F(Gov2SortedDataSet, DeltaFastPFor256Encode)(benchmark::State& state) {
-  benchmarkGov2SortedDataSet(this, state, encodeWithDeltaFastPFor256);
+  return true;
 }
 
-BENCHMARK_F(Gov2SortedDataSet, DeltaFastPFor256Decode)(benchmark::State& state) {
-  benchmarkGov2SortedDataSet(this, state, decodeWithDeltaFastPFor256);
-}
+static bool codecBenchmarksRegistered = registerCodecBenchmarks();
@@ -0,0 +1,149 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "container.h"
+
+#include "benchmark/include/benchmark/benchmark.h"
+#include "SIMDCompressionAndIntersection/include/codecs.h"
+
+// The container holds a random sample of 8192 lists of gov2.sorted whose
+// length is in [128, 65536).
+typedef SampledGov2Fixture<8192, 128, 1 << 16, 7> Gov2Container;
+
+// Batches fetched per iteration.
+static const size_t numBatches = 32;
+
+// Reads in flight: the depth of the io_uring queue and the number of threads
+// of the pread() pool.
+static const unsigned ioDepth = 32;
+
+enum FetchMethod {
+  FETCH_IO_URING,
+  FETCH_PREAD_POOL,
+  FETCH_MMAP
+};
+
+static std::unique_ptr<ListFetcher> makeFetcher(FetchMethod method, const ListContainer& container, const CodecDescriptor& desc) {
+  switch (method) {
+    case FETCH_IO_URING:
+      return std::unique_ptr<ListFetcher>(new IoUringFetcher(container, desc, ioDepth));
+    case FETCH_PREAD_POOL:
+      return std::unique_ptr<ListFetcher>(new PreadPoolFetcher(container, desc, ioDepth));
+    case FETCH_MMAP:
+      return std::unique_ptr<ListFetcher>(new MmapFetcher(container, desc));
+  }
+
+  throw std::logic_error("unknown fetch method");
+}
+
+// Writes the sample to a container file in the scratch directory and fetches
+// random batches of state.range(0) lists with the given method. When
+// state.range(1) is 1, the file is evicted from the page cache before every
+// iteration. The latency counters are per batch, from the first read to the
+// last list decoded.
+template <FetchMethod method>
+static void benchmarkFetch(Gov2Container* obj, const CodecDescriptor& desc, benchmark::State& state) {
+  std::vector<std::vector<uint32_t> >& sample = Gov2Container::sample;
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = Gov2Container::CreateCodec(desc, state);
+  if (!codec) {
+    return;
+  }
+  const size_t batchSize = state.range(0);
+  const bool cold = state.range(1) != 0;
+
+  ListContainer container(GlobalState::scratchDirectory + "/" + desc.name + ".container", *codec, desc.blockSize, sample);
+  std::unique_ptr<ListFetcher> fetcher;
+
+  try {
+    fetcher = makeFetcher(method, container, desc);
+  } catch (const std::runtime_error& e) {
+    state.SkipWithError(e.what());
+    return;
+  }
+
+  std::mt19937 generator(1234);
+  std::uniform_int_distribution<uint32_t> randomList(0, sample.size() - 1);
+  std::vector<std::vector<uint32_t> > batches(numBatches, std::vector<uint32_t>(batchSize));
+
+  for (std::vector<uint32_t>& batch : batches) {
+    for (uint32_t& list : batch) {
+      list = randomList(generator);
+    }
+  }
+
+  // Every list of the first batch is checked once before measuring.
+  std::atomic<bool> equal(true);
+  fetcher->Fetch(batches[0], [&](size_t list, const uint32_t *values, size_t length) {
+    if (length != sample[list].size() || !std::equal(values, values + length, sample[list].begin())) {
+      equal = false;
+    }
+  });
+  if (!equal) {
+    throw std::logic_error("equality check failed");
+  }
+
+  ListFetcher::Consumer consume = [](size_t list, const uint32_t *values, size_t length) {
+    benchmark::DoNotOptimize(values[length - 1]);
+  };
+  LatencyHistogram latencies;
+  uint64_t bytesRead = 0;
+
+  for (auto _ : state) {
+    if (cold) {
+      state.PauseTiming();
+      fetcher->Reset();
+      container.DropPageCache();
+      state.ResumeTiming();
+    }
+
+    for (const std::vector<uint32_t>& batch : batches) {
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      fetcher->Fetch(batch, consume);
+      std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+      latencies.Add(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    }
+  }
+
+  for (const std::vector<uint32_t>& batch : batches) {
+    for (uint32_t list : batch) {
+      bytesRead += container.GetEntry(list).encodedLength * sizeof(uint32_t);
+    }
+  }
+
+  state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(numBatches * batchSize));
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(bytesRead));
+  state.counters["p50Ns"] = latencies.Percentile(50);
+  state.counters["p99Ns"] = latencies.Percentile(99);
+  state.counters["maxNs"] = latencies.Max();
+  state.counters["fileSize"] = container.FileSize();
+}
+
+// Arguments: lists per batch and whether the page cache is dropped.
+static bool registerBenchmarks() {
+  for (auto b : RegisterVTEncAndCodecBenchmarks<Gov2Container>("Gov2Container", "IoUring", benchmarkFetch<FETCH_IO_URING>)) {
+    b->ArgsProduct({{16, 128}, {0, 1}})->UseRealTime();
+  }
+
+  for (auto b : RegisterVTEncAndCodecBenchmarks<Gov2Container>("Gov2Container", "PreadPool", benchmarkFetch<FETCH_PREAD_POOL>)) {
+    b->ArgsProduct({{16, 128}, {0, 1}})->UseRealTime();
+  }
+
+  for (auto b : RegisterVTEncAndCodecBenchmarks<Gov2Container>("Gov2Container", "Mmap", benchmarkFetch<FETCH_MMAP>)) {
+    b->ArgsProduct({{16, 128}, {0, 1}})->UseRealTime();
+  }
+
+  return true;
+}
+
+static bool benchmarksRegistered = registerBenchmarks();
@@ -0,0 +1,234 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common.h"
+#include "packedlists.h"
+
+#include "benchmark/include/benchmark/benchmark.h"
+#include "SIMDCompressionAndIntersection/include/codecs.h"
+
+// Short lists of gov2.sorted, that is, the lists shorter than the first
+// benchmark argument, kept in memory.
+class Gov2PackedLists : public benchmark::Fixture {
+public:
+  static std::unordered_map<size_t, std::vector<std::vector<uint32_t> > > lists_map;
+
+  void SetUp(const ::benchmark::State& state) {
+    size_t maxLength = state.range(0);
+
+    if (lists_map.find(maxLength) == lists_map.end()) {
+      LoadGov2SortedSets(lists_map[maxLength], 1, maxLength);
+    }
+  }
+
+  void TearDown(const ::benchmark::State& state) {}
+};
+
+std::unordered_map<size_t, std::vector<std::vector<uint32_t> > > Gov2PackedLists::lists_map =
+  std::unordered_map<size_t, std::vector<std::vector<uint32_t> > >();
+
+static std::vector<uint32_t> concatenate(const std::vector<std::vector<uint32_t> >& lists) {
+  std::vector<uint32_t> all;
+
+  for (const std::vector<uint32_t>& list : lists) {
+    all.insert(all.end(), list.begin(), list.end());
+  }
+
+  return all;
+}
+
+static void setPackedListsStats(
+  benchmark::State& state,
+  CompressionStats& stats,
+  size_t numLists,
+  size_t inputLength,
+  size_t encodedLength,
+  size_t directoryLength)
+{
+  stats.SetInputLengthInBytes(inputLength * sizeof(uint32_t));
+  stats.SetEncodedLengthInBytes(encodedLength);
+  stats.SetFinalStats();
+  state.counters["lists"] = numLists;
+  state.counters["directoryLength"] = directoryLength;
+}
+
+static void benchmarkPerListDecode(Gov2PackedLists* obj, const CodecDescriptor& desc, benchmark::State& state) {
+  std::vector<std::vector<uint32_t> >& lists = Gov2PackedLists::lists_map[state.range(0)];
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = desc.create();
+  if (!codec) {
+    state.SkipWithError("codec not available");
+    return;
+  }
+
+  std::vector<uint32_t> data = concatenate(lists);
+  std::vector<uint32_t> decoded(data.size());
+  ListStore store(*codec, desc.blockSize);
+
+  store.Build(lists);
+
+  CompressionStats stats(state);
+
+  for (auto _ : state)
+    store.DecodeAll(decoded.data());
+
+  setPackedListsStats(state, stats, store.NumLists(), data.size(),
+    store.EncodedLengthInBytes(), store.DirectoryLengthInBytes());
+
+  if (data != decoded) {
+    throw std::logic_error("equality check failed");
+  }
+}
+
+static void benchmarkPackedDecode(Gov2PackedLists* obj, const CodecDescriptor& desc, benchmark::State& state) {
+  std::vector<std::vector<uint32_t> >& lists = Gov2PackedLists::lists_map[state.range(0)];
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = desc.create();
+  if (!codec) {
+    state.SkipWithError("codec not available");
+    return;
+  }
+
+  std::vector<uint32_t> data = concatenate(lists);
+  std::vector<uint32_t> decoded(data.size());
+  PackedListStore store(*codec, desc.blockSize, state.range(1));
+
+  store.Build(lists);
+
+  CompressionStats stats(state);
+
+  for (auto _ : state)
+    store.DecodeAll(decoded.data());
+
+  setPackedListsStats(state, stats, store.NumLists(), data.size(),
+    store.EncodedLengthInBytes(), store.DirectoryLengthInBytes());
+
+  if (data != decoded) {
+    throw std::logic_error("equality check failed");
+  }
+  state.counters["pages"] = store.NumPages();
+}
+
+// Number of lists decoded in every iteration of the lookup benchmarks.
+static const size_t numLookups = 1024;
+
+// Decodes, one at a time, lists drawn at random from the store. Every lookup
+// is checked once before the timed loop. The input length is that of the
+// looked-up lists, while the compression ratio is that of the whole store.
+template <class Store>
+static void benchmarkLookups(
+  Store& store,
+  const std::vector<std::vector<uint32_t> >& lists,
+  benchmark::State& state)
+{
+  if (lists.empty()) {
+    state.SkipWithError("no lists to look up");
+    return;
+  }
+
+  std::mt19937 generator(5);
+  std::uniform_int_distribution<size_t> dist(0, lists.size() - 1);
+  std::vector<size_t> indexes(numLookups);
+  std::vector<uint32_t> decoded(state.range(0));
+  size_t inputLength = 0, storeLength = 0;
+
+  for (size_t& index : indexes) {
+    index = dist(generator);
+  }
+
+  for (size_t index : indexes) {
+    const std::vector<uint32_t>& list = lists[index];
+    if (store.Decode(index, decoded.data()) != list.size() ||
+        !std::equal(list.begin(), list.end(), decoded.begin())) {
+      throw std::logic_error("equality check failed");
+    }
+    inputLength += list.size();
+  }
+
+  for (const std::vector<uint32_t>& list : lists) {
+    storeLength += list.size();
+  }
+
+  CompressionStats stats(state);
+
+  for (auto _ : state) {
+    for (size_t index : indexes) {
+      store.Decode(index, decoded.data());
+    }
+    benchmark::DoNotOptimize(decoded.data());
+  }
+
+  setPackedListsStats(state, stats, store.NumLists(), inputLength,
+    store.EncodedLengthInBytes(), store.DirectoryLengthInBytes());
+  state.counters["compressionRatio"] = double(storeLength * sizeof(uint32_t)) / store.EncodedLengthInBytes();
+  state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(numLookups));
+}
+
+static void benchmarkPerListLookup(Gov2PackedLists* obj, const CodecDescriptor& desc, benchmark::State& state) {
+  std::vector<std::vector<uint32_t> >& lists = Gov2PackedLists::lists_map[state.range(0)];
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = desc.create();
+  if (!codec) {
+    state.SkipWithError("codec not available");
+    return;
+  }
+
+  ListStore store(*codec, desc.blockSize);
+
+  store.Build(lists);
+  benchmarkLookups(store, lists, state);
+}
+
+static void benchmarkPackedLookup(Gov2PackedLists* obj, const CodecDescriptor& desc, benchmark::State& state) {
+  std::vector<std::vector<uint32_t> >& lists = Gov2PackedLists::lists_map[state.range(0)];
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = desc.create();
+  if (!codec) {
+    state.SkipWithError("codec not available");
+    return;
+  }
+
+  PackedListStore store(*codec, desc.blockSize, state.range(1));
+
+  store.Build(lists);
+  benchmarkLookups(store, lists, state);
+  state.counters["pages"] = store.NumPages();
+}
+
+// Arguments: maximum list length (exclusive) and, for the packed stores, the
+// maximum number of integers per page.
+static void registerPackedListsBenchmarks(const CodecDescriptor& codec) {
+  const std::string prefix = "Gov2PackedLists/" + codec.name;
+
+  benchmark::internal::RegisterBenchmarkInternal(
+    new CodecBenchmark<Gov2PackedLists>(prefix + "PerListDecode", codec, benchmarkPerListDecode))
+    ->Arg(16)->Arg(128);
+
+  benchmark::internal::RegisterBenchmarkInternal(
+    new CodecBenchmark<Gov2PackedLists>(prefix + "PackedDecode", codec, benchmarkPackedDecode))
+    ->ArgsProduct({{16, 128}, {1024, 16384}});
+
+  benchmark::internal::RegisterBenchmarkInternal(
+    new CodecBenchmark<Gov2PackedLists>(prefix + "PerListLookup", codec, benchmarkPerListLookup))
+    ->Arg(16)->Arg(128);
+
+  benchmark::internal::RegisterBenchmarkInternal(
+    new CodecBenchmark<Gov2PackedLists>(prefix + "PackedLookup", codec, benchmarkPackedLookup))
+    ->ArgsProduct({{16, 128}, {1024, 16384}});
+}
+
+static bool registerBenchmarks() {
+  registerPackedListsBenchmarks(VTEncCodecDescriptor());
+
+  for (const CodecDescriptor& codec : CodecTable()) {
+    registerPackedListsBenchmarks(codec);
+  }
+
+  return true;
+}
+
+static bool benchmarksRegistered = registerBenchmarks();
@@ -0,0 +1,184 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "stratified.h"
+#include "vtenccodec.h"
+
+#include "benchmark/include/benchmark/benchmark.h"
+#include "SIMDCompressionAndIntersection/include/codecs.h"
+
+// Every list of the sample is encoded or decoded at least this many integers'
+// worth of times per iteration, so that the short ones take long enough to be
+// timed.
+static const size_t minTimedIntegers = 4096;
+
+class Gov2Sample : public benchmark::Fixture {
+public:
+  static StratifiedSample sample;
+
+  void SetUp(const ::benchmark::State& state) {
+    if (GlobalState::gov2SampleFraction > 0 && sample.Empty()) {
+      sample.Build(Gov2SortedPath(), GlobalState::gov2SampleFraction, 5);
+    }
+  }
+
+  void TearDown(const ::benchmark::State& state) {}
+};
+
+StratifiedSample Gov2Sample::sample = StratifiedSample();
+
+static size_t repetitions(size_t length) {
+  return std::max(size_t(1), minTimedIntegers / std::max(length, size_t(1)));
+}
+
+// Extrapolates the encoded size and the time of the sample to the whole file,
+// with their 95% confidence intervals.
+static void setCorpusCounters(
+  benchmark::State& state,
+  const std::vector<double>& encodedBytes,
+  const std::vector<double>& seconds)
+{
+  const StratifiedSample& sample = Gov2Sample::sample;
+  const double inputBytes = double(sample.NumIntegers()) * sizeof(uint32_t);
+  const Estimate bytes = sample.EstimateTotal(encodedBytes);
+  const Estimate time = sample.EstimateTotal(seconds);
+
+  state.counters["sampleLists"] = sample.Lists().size();
+  state.counters["sampleShare"] = double(sample.SampledIntegers()) / std::max(sample.NumIntegers(), uint64_t(1));
+
+  state.counters["corpusEncodedBytes"] = bytes.total;
+  state.counters["corpusEncodedBytesCI"] = bytes.halfWidth;
+  state.counters["corpusRatio"] = inputBytes / bytes.total;
+  state.counters["corpusRatioLow"] = (bytes.High() > 0) ? inputBytes / bytes.High() : 0;
+  state.counters["corpusRatioHigh"] = (bytes.Low() > 0) ? inputBytes / bytes.Low() : 0;
+
+  state.counters["corpusSeconds"] = time.total;
+  state.counters["corpusSecondsCI"] = time.halfWidth;
+  state.counters["corpusBytesPerSecond"] = inputBytes / time.total;
+  state.counters["corpusBytesPerSecondLow"] = (time.High() > 0) ? inputBytes / time.High() : 0;
+  state.counters["corpusBytesPerSecondHigh"] = (time.Low() > 0) ? inputBytes / time.Low() : 0;
+}
+
+static bool checkSample(benchmark::State& state) {
+  if (GlobalState::gov2SampleFraction <= 0) {
+    state.SkipWithError("needs --gov2-sample");
+    return false;
+  }
+  if (Gov2Sample::sample.Empty()) {
+    state.SkipWithError("no lists in the sample");
+    return false;
+  }
+  return true;
+}
+
+static void benchmarkSampleEncode(SIMDCompressionLib::IntegerCODEC& codec, size_t blockSize, benchmark::State& state) {
+  std::vector<std::vector<uint32_t> >& lists = Gov2Sample::sample.Lists();
+  std::vector<std::unique_ptr<SIMDCompressionUtil> > comps;
+  std::vector<double> encodedBytes, seconds(lists.size(), 0.0);
+
+  for (std::vector<uint32_t>& list : lists) {
+    comps.emplace_back(new SIMDCompressionUtil(codec, blockSize, list));
+    comps.back()->Encode();
+    encodedBytes.push_back(double(comps.back()->EncodedLength()) * sizeof(uint32_t));
+  }
+
+  for (auto _ : state) {
+    for (size_t i = 0; i < comps.size(); ++i) {
+      seconds[i] += TimeEncode(*comps[i], repetitions(lists[i].size()));
+    }
+  }
+
+  for (double& s : seconds) {
+    s /= std::max(double(state.iterations()), 1.0);
+  }
+
+  setCorpusCounters(state, encodedBytes, seconds);
+}
+
+static void benchmarkSampleDecode(SIMDCompressionLib::IntegerCODEC& codec, size_t blockSize, benchmark::State& state) {
+  std::vector<std::vector<uint32_t> >& lists = Gov2Sample::sample.Lists();
+  std::vector<std::unique_ptr<SIMDCompressionUtil> > comps;
+  std::vector<double> encodedBytes, seconds(lists.size(), 0.0);
+
+  for (std::vector<uint32_t>& list : lists) {
+    comps.emplace_back(new SIMDCompressionUtil(codec, blockSize, list));
+    comps.back()->Encode();
+    encodedBytes.push_back(double(comps.back()->EncodedLength()) * sizeof(uint32_t));
+  }
+
+  for (auto _ : state) {
+    for (size_t i = 0; i < comps.size(); ++i) {
+      seconds[i] += TimeDecode(*comps[i], repetitions(lists[i].size()));
+    }
+  }
+
+  for (size_t i = 0; i < comps.size(); ++i) {
+    comps[i]->EqualityCheck();
+    seconds[i] /= std::max(double(state.iterations()), 1.0);
+  }
+
+  setCorpusCounters(state, encodedBytes, seconds);
+}
+
+static void benchmarkCodecEncode(Gov2Sample* obj, const CodecDescriptor& desc, benchmark::State& state) {
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = desc.create();
+  if (!codec) {
+    state.SkipWithError("codec not available");
+    return;
+  }
+  if (checkSample(state)) {
+    benchmarkSampleEncode(*codec, desc.blockSize, state);
+  }
+}
+
+static void benchmarkCodecDecode(Gov2Sample* obj, const CodecDescriptor& desc, benchmark::State& state) {
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = desc.create();
+  if (!codec) {
+    state.SkipWithError("codec not available");
+    return;
+  }
+  if (checkSample(state)) {
+    benchmarkSampleDecode(*codec, desc.blockSize, state);
+  }
+}
+
+// state.range(0) is the VTEnc min_cluster_length, as in Gov2SortedDataSet.
+static void benchmarkVTEncEncode(Gov2Sample* obj, const CodecDescriptor& desc, benchmark::State& state) {
+  VTEncCodec codec(static_cast<size_t>(state.range(0)));
+
+  if (checkSample(state)) {
+    benchmarkSampleEncode(codec, desc.blockSize, state);
+  }
+}
+
+static void benchmarkVTEncDecode(Gov2Sample* obj, const CodecDescriptor& desc, benchmark::State& state) {
+  VTEncCodec codec(static_cast<size_t>(state.range(0)));
+
+  if (checkSample(state)) {
+    benchmarkSampleDecode(codec, desc.blockSize, state);
+  }
+}
+
+static bool registerBenchmarks() {
+  benchmark::internal::RegisterBenchmarkInternal(
+    new CodecBenchmark<Gov2Sample>("Gov2Sample/VTEncEncode", VTEncCodecDescriptor(), benchmarkVTEncEncode))
+    ->RangeMultiplier(2)->Range(1, 1<<8);
+
+  benchmark::internal::RegisterBenchmarkInternal(
+    new CodecBenchmark<Gov2Sample>("Gov2Sample/VTEncDecode", VTEncCodecDescriptor(), benchmarkVTEncDecode))
+    ->RangeMultiplier(2)->Range(1, 1<<8);
+
+  RegisterCodecBenchmarks<Gov2Sample>("Gov2Sample", "Encode", benchmarkCodecEncode);
+  RegisterCodecBenchmarks<Gov2Sample>("Gov2Sample", "Decode", benchmarkCodecDecode);
+
+  return true;
+}
+
+static bool benchmarksRegistered = registerBenchmarks();
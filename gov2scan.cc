@@ -0,0 +1,48 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#include <memory>
+#include <vector>
+
+#include "blockiterator.h"
+#include "common.h"
+
+#include "benchmark/include/benchmark/benchmark.h"
+#include "SIMDCompressionAndIntersection/include/codecs.h"
+
+// The lists are a random sample of 64 lists of gov2.sorted whose length is in
+// [2^10, 2^20).
+typedef SampledGov2Fixture<64, 1 << 10, 1 << 20, 5> Gov2Scan;
+
+// state.range(0) is the FusedConsumer.
+static void benchmarkScanFull(Gov2Scan* obj, const CodecDescriptor& desc, benchmark::State& state) {
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = Gov2Scan::CreateCodec(desc, state);
+  if (!codec) {
+    return;
+  }
+  BenchmarkFusedScan(*codec, desc.blockSize, Gov2Scan::sample, FusedConsumer(state.range(0)), 0, state);
+}
+
+// state.range(0) is the FusedConsumer and state.range(1) the block length.
+static void benchmarkScanBlocks(Gov2Scan* obj, const CodecDescriptor& desc, benchmark::State& state) {
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = Gov2Scan::CreateCodec(desc, state);
+  if (!codec) {
+    return;
+  }
+  BenchmarkFusedScan(*codec, desc.blockSize, Gov2Scan::sample, FusedConsumer(state.range(0)), state.range(1), state);
+}
+
+static bool registerBenchmarks() {
+  for (auto b : RegisterVTEncAndCodecBenchmarks<Gov2Scan>("Gov2Scan", "ScanFull", benchmarkScanFull)) {
+    b->DenseRange(FUSED_SUM, FUSED_FILTER_BITMAP);
+  }
+
+  for (auto b : RegisterVTEncAndCodecBenchmarks<Gov2Scan>("Gov2Scan", "ScanBlocks", benchmarkScanBlocks)) {
+    b->ArgsProduct({{FUSED_SUM, FUSED_COUNT_IN_RANGE, FUSED_FILTER_BITMAP}, {128, 256}});
+  }
+
+  return true;
+}
+
+static bool benchmarksRegistered = registerBenchmarks();
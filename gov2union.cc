@@ -0,0 +1,154 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "listunion.h"
+#include "packedlists.h"
+
+#include "benchmark/include/benchmark/benchmark.h"
+#include "SIMDCompressionAndIntersection/include/codecs.h"
+
+// The union queries take their lists from a random sample of 512 lists of
+// gov2.sorted whose length is in [2^10, 2^17).
+typedef SampledGov2Fixture<512, 1 << 10, 1 << 17, 42> Gov2Union;
+
+// Number of union queries for every value of k.
+static const size_t numQueries = 8;
+
+enum UnionMethod {
+  UNION_HEAP_MERGE,
+  UNION_SIMD_MERGE,
+  UNION_BITMAP
+};
+
+// Every query decodes its k lists from a ListStore and computes their union
+// with the given method. state.range(0) is k. Every query is checked once
+// against the heap merge of the original lists before measuring. The reported
+// rate is the number of integers in the unions per second.
+template <UnionMethod method>
+static void benchmarkUnion(Gov2Union* obj, const CodecDescriptor& desc, benchmark::State& state) {
+  std::vector<std::vector<uint32_t> >& sample = Gov2Union::sample;
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = Gov2Union::CreateCodec(desc, state);
+  if (!codec) {
+    return;
+  }
+  const size_t k = std::min(size_t(state.range(0)), sample.size());
+  ListStore store(*codec, desc.blockSize);
+
+  store.Build(sample);
+
+  std::mt19937 generator(1234);
+  std::vector<size_t> indexes(sample.size());
+  std::vector<std::vector<size_t> > queries(numQueries);
+
+  for (size_t i = 0; i < indexes.size(); ++i) {
+    indexes[i] = i;
+  }
+
+  for (std::vector<size_t>& query : queries) {
+    std::shuffle(indexes.begin(), indexes.end(), generator);
+    query.assign(indexes.begin(), indexes.begin() + k);
+  }
+
+  size_t maxInputLength = 0;
+  for (const std::vector<size_t>& query : queries) {
+    size_t inputLength = 0;
+    for (size_t index : query) {
+      inputLength += sample[index].size();
+    }
+    maxInputLength = std::max(maxInputLength, inputLength);
+  }
+
+  std::vector<uint32_t> decoded(maxInputLength);
+  std::vector<uint32_t> result(maxInputLength);
+  std::vector<SortedList> lists(k);
+  ListUnion listUnion;
+
+  // Decodes the lists of the query and computes their union in `result`.
+  // Returns the length of the union; `offset` is left as the number of
+  // integers decoded.
+  auto runQuery = [&](const std::vector<size_t>& query, size_t& offset) -> size_t {
+    offset = 0;
+
+    for (size_t l = 0; l < k; ++l) {
+      const size_t length = store.Decode(query[l], decoded.data() + offset);
+      lists[l] = SortedList{decoded.data() + offset, length};
+      offset += length;
+    }
+
+    switch (method) {
+      case UNION_HEAP_MERGE:
+        return listUnion.HeapMerge(lists, result.data());
+      case UNION_SIMD_MERGE:
+        return listUnion.SIMDMerge(lists, result.data());
+      case UNION_BITMAP:
+        return listUnion.Bitmap(lists, result.data());
+    }
+    return size_t(0);
+  };
+
+  std::vector<uint32_t> expected(maxInputLength);
+  std::vector<SortedList> originalLists(k);
+
+  for (const std::vector<size_t>& query : queries) {
+    size_t offset;
+    const size_t length = runQuery(query, offset);
+
+    for (size_t l = 0; l < k; ++l) {
+      originalLists[l] = SortedList{sample[query[l]].data(), sample[query[l]].size()};
+    }
+
+    const size_t expectedLength = listUnion.HeapMerge(originalLists, expected.data());
+    if (length != expectedLength || !std::equal(expected.begin(), expected.begin() + expectedLength, result.begin())) {
+      throw std::logic_error("equality check failed");
+    }
+  }
+
+  size_t inputLength = 0;
+  size_t outputLength = 0;
+
+  for (auto _ : state) {
+    inputLength = 0;
+    outputLength = 0;
+
+    for (const std::vector<size_t>& query : queries) {
+      size_t offset;
+      const size_t length = runQuery(query, offset);
+
+      benchmark::DoNotOptimize(result.data());
+      inputLength += offset;
+      outputLength += length;
+    }
+  }
+
+  state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(outputLength));
+  state.counters["inputLength"] = inputLength;
+  state.counters["outputLength"] = outputLength;
+  state.counters["encodedLength"] = store.EncodedLengthInBytes();
+}
+
+static bool registerBenchmarks() {
+  for (auto b : RegisterVTEncAndCodecBenchmarks<Gov2Union>("Gov2Union", "HeapMerge", benchmarkUnion<UNION_HEAP_MERGE>)) {
+    b->Arg(2)->Arg(8)->Arg(32)->Arg(128);
+  }
+
+  for (auto b : RegisterVTEncAndCodecBenchmarks<Gov2Union>("Gov2Union", "SIMDMerge", benchmarkUnion<UNION_SIMD_MERGE>)) {
+    b->Arg(2)->Arg(8)->Arg(32)->Arg(128);
+  }
+
+  for (auto b : RegisterVTEncAndCodecBenchmarks<Gov2Union>("Gov2Union", "Bitmap", benchmarkUnion<UNION_BITMAP>)) {
+    b->Arg(2)->Arg(8)->Arg(32)->Arg(128);
+  }
+
+  return true;
+}
+
+static bool benchmarksRegistered = registerBenchmarks();
@@ -0,0 +1,53 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#include <memory>
+#include <vector>
+
+#include "common.h"
+#include "updatableset.h"
+
+#include "benchmark/include/benchmark/benchmark.h"
+#include "SIMDCompressionAndIntersection/include/codecs.h"
+
+// The sets are built from a random sample of 16 lists of gov2.sorted whose
+// length is in [2^14, 2^18).
+typedef SampledGov2Fixture<16, 1 << 14, 1 << 18, 5> Gov2Updates;
+
+// state.range(0) is the number of updates, in thousandths of the integers of
+// the sample.
+template <SetUpdateBenchmark operation>
+static void benchmarkUpdates(Gov2Updates* obj, const CodecDescriptor& desc, benchmark::State& state) {
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = Gov2Updates::CreateCodec(desc, state);
+  if (!codec) {
+    return;
+  }
+  BenchmarkSetUpdates(*codec, desc.blockSize, Gov2Updates::sample, operation, state.range(0), state);
+}
+
+static bool registerBenchmarks() {
+  for (auto b : RegisterVTEncAndCodecBenchmarks<Gov2Updates>("Gov2Updates", "SetInsert", benchmarkUpdates<SET_UPDATE_INSERT>)) {
+    b->Arg(10)->Arg(500);
+  }
+
+  for (auto b : RegisterVTEncAndCodecBenchmarks<Gov2Updates>("Gov2Updates", "SetDelete", benchmarkUpdates<SET_UPDATE_DELETE>)) {
+    b->Arg(10)->Arg(500);
+  }
+
+  for (auto b : RegisterVTEncAndCodecBenchmarks<Gov2Updates>("Gov2Updates", "SetCompact", benchmarkUpdates<SET_UPDATE_COMPACT>)) {
+    b->Arg(10)->Arg(500);
+  }
+
+  for (auto b : RegisterVTEncAndCodecBenchmarks<Gov2Updates>("Gov2Updates", "SetRead", benchmarkUpdates<SET_UPDATE_READ>)) {
+    b->Arg(10)->Arg(500);
+  }
+
+  for (auto b : RegisterVTEncAndCodecBenchmarks<Gov2Updates>("Gov2Updates", "SetReadCompacted", benchmarkUpdates<SET_UPDATE_READ_COMPACTED>)) {
+    b->Arg(10)->Arg(500);
+  }
+
+  return true;
+}
+
+static bool benchmarksRegistered = registerBenchmarks();
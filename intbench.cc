@@ -2,27 +2,80 @@
 // Licensed under the MIT License.
 // See LICENSE file in the project root for full license information.
 
+#include <cstdlib>
+#include <exception>
 #include <iostream>
 #include <string>
 
 #include "common.h"
+#include "costmodel.h"
+#include "reorder.h"
 
 #include "benchmark/include/benchmark/benchmark.h"
 
-void ParseArguments(int argc, char** argv) {
+bool ParseHugePagesMode(const std::string& value, HugePagesMode& mode) {
+  if (value == "off") {
+    mode = HUGE_PAGES_OFF;
+  } else if (value == "thp") {
+    mode = HUGE_PAGES_THP;
+  } else if (value == "hugetlb") {
+    mode = HUGE_PAGES_HUGETLB;
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+std::string reorderGov2File;
+std::string costModelFile;
+
+bool ParseArguments(int argc, char** argv) {
   const std::string dataDirFlag = std::string("--data-dir=");
+  const std::string hugePagesFlag = std::string("--hugepages=");
+  const std::string scratchDirFlag = std::string("--scratch-dir=");
+  const std::string gov2FileFlag = std::string("--gov2-file=");
+  const std::string reorderGov2Flag = std::string("--reorder-gov2=");
+  const std::string gov2SampleFlag = std::string("--gov2-sample=");
+  const std::string costModelFlag = std::string("--cost-model=");
 
   for (int i = 1; i < argc; ++i) {
     std::string opt(argv[i]);
 
     if (dataDirFlag.compare(opt.substr(0, dataDirFlag.length())) == 0) {
       GlobalState::dataDirectory = std::string(opt.substr(dataDirFlag.length()));
+    } else if (scratchDirFlag.compare(opt.substr(0, scratchDirFlag.length())) == 0) {
+      GlobalState::scratchDirectory = std::string(opt.substr(scratchDirFlag.length()));
+    } else if (gov2FileFlag.compare(opt.substr(0, gov2FileFlag.length())) == 0) {
+      GlobalState::gov2File = std::string(opt.substr(gov2FileFlag.length()));
+    } else if (reorderGov2Flag.compare(opt.substr(0, reorderGov2Flag.length())) == 0) {
+      reorderGov2File = std::string(opt.substr(reorderGov2Flag.length()));
+    } else if (costModelFlag.compare(opt.substr(0, costModelFlag.length())) == 0) {
+      costModelFile = std::string(opt.substr(costModelFlag.length()));
+    } else if (gov2SampleFlag.compare(opt.substr(0, gov2SampleFlag.length())) == 0) {
+      const std::string value = opt.substr(gov2SampleFlag.length());
+      char *end = NULL;
+
+      GlobalState::gov2SampleFraction = std::strtod(value.c_str(), &end);
+      if (value.empty() || *end != '\0' || !(GlobalState::gov2SampleFraction > 0 && GlobalState::gov2SampleFraction <= 1)) {
+        std::cerr << "invalid --gov2-sample value: " << value << std::endl;
+        return false;
+      }
+    } else if (hugePagesFlag.compare(opt.substr(0, hugePagesFlag.length())) == 0) {
+      if (!ParseHugePagesMode(opt.substr(hugePagesFlag.length()), GlobalState::hugePages)) {
+        std::cerr << "invalid --hugepages value: " << opt.substr(hugePagesFlag.length()) << std::endl;
+        return false;
+      }
     }
   }
+
+  return true;
 }
 
 void Usage(const std::string& programName) {
-  std::cerr << "Usage: " << programName << " --data-dir=DIRPATH [BENCHMARK_OPTIONS]" << std::endl;
+  std::cerr << "Usage: " << programName << " --data-dir=DIRPATH [--scratch-dir=DIRPATH] [--gov2-file=FILENAME] [--gov2-sample=FRACTION] [--hugepages=off|thp|hugetlb] [BENCHMARK_OPTIONS]" << std::endl;
+  std::cerr << "       " << programName << " --data-dir=DIRPATH [--gov2-file=FILENAME] --reorder-gov2=FILENAME" << std::endl;
+  std::cerr << "       " << programName << " --data-dir=DIRPATH [--gov2-file=FILENAME] --cost-model=FILEPATH" << std::endl;
 }
 
 int main(int argc, char** argv) {
@@ -31,7 +84,10 @@ int main(int argc, char** argv) {
     return 1;
   }
 
-  ParseArguments(argc, argv);
+  if (!ParseArguments(argc, argv)) {
+    Usage(std::string(argv[0]));
+    return 1;
+  }
 
   if (GlobalState::dataDirectory.empty()) {
     std::cerr << "--data-dir argument not provided" << std::endl;
@@ -39,7 +95,41 @@ int main(int argc, char** argv) {
     return 1;
   }
 
+  if (GlobalState::scratchDirectory.empty()) {
+    GlobalState::scratchDirectory = GlobalState::dataDirectory;
+  }
+
+  const char *hugePagesNames[] = {"off", "thp", "hugetlb"};
+
   std::cout << "Data directory: " << GlobalState::dataDirectory << std::endl;
+  std::cout << "Scratch directory: " << GlobalState::scratchDirectory << std::endl;
+  std::cout << "Gov2 file: " << GlobalState::gov2File << std::endl;
+  if (GlobalState::gov2SampleFraction > 0) {
+    std::cout << "Gov2 sample: " << GlobalState::gov2SampleFraction << std::endl;
+  }
+  std::cout << "Huge pages: " << hugePagesNames[GlobalState::hugePages] << std::endl;
+
+  if (!reorderGov2File.empty()) {
+    try {
+      ReorderGov2(reorderGov2File);
+    } catch (const std::exception& e) {
+      std::cerr << e.what() << std::endl;
+      return 1;
+    }
+
+    return 0;
+  }
+
+  if (!costModelFile.empty()) {
+    try {
+      CalibrateCostModels(costModelFile);
+    } catch (const std::exception& e) {
+      std::cerr << e.what() << std::endl;
+      return 1;
+    }
+
+    return 0;
+  }
 
   benchmark::Initialize(&argc, argv);
   benchmark::RunSpecifiedBenchmarks();
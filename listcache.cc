@@ -0,0 +1,108 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#include "listcache.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+static size_t listBytes(const DecodedListCache::List& list) {
+  return list->size() * sizeof(uint32_t);
+}
+
+DecodedListCache::DecodedListCache(size_t budgetInBytes, size_t numShards)
+  : _shards(numShards), _shardBudget(budgetInBytes / numShards)
+{
+  for (std::unique_ptr<Shard>& shard : _shards) {
+    shard.reset(new Shard());
+    shard->hand = 0;
+    shard->usedBytes = 0;
+  }
+}
+
+DecodedListCache::Shard& DecodedListCache::shardOf(uint32_t key) {
+  // Multiplicative hashing, so that consecutive keys go to different shards.
+  return *_shards[(uint64_t(key * 2654435761u) * _shards.size()) >> 32];
+}
+
+// Frees entries until `bytes` more bytes fit in the shard. Must be called with
+// the lock of the shard held.
+void DecodedListCache::evict(Shard& shard, size_t bytes) {
+  while (shard.usedBytes + bytes > _shardBudget) {
+    Entry& entry = shard.entries[shard.hand];
+
+    if (entry.list) {
+      if (entry.referenced) {
+        entry.referenced = false;
+      } else {
+        shard.usedBytes -= listBytes(entry.list);
+        shard.index.erase(entry.key);
+        shard.freeEntries.push_back(shard.hand);
+        entry.list.reset();
+      }
+    }
+
+    shard.hand = (shard.hand + 1) % shard.entries.size();
+  }
+}
+
+DecodedListCache::List DecodedListCache::Get(uint32_t key) {
+  Shard& shard = shardOf(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  std::unordered_map<uint32_t, size_t>::iterator it = shard.index.find(key);
+
+  if (it == shard.index.end()) {
+    return List();
+  }
+
+  Entry& entry = shard.entries[it->second];
+  entry.referenced = true;
+  return entry.list;
+}
+
+void DecodedListCache::Insert(uint32_t key, const List& list) {
+  const size_t bytes = listBytes(list);
+
+  if (bytes > _shardBudget) {
+    return;
+  }
+
+  Shard& shard = shardOf(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+
+  // Another thread may have decoded the same list in the meantime.
+  if (shard.index.find(key) != shard.index.end()) {
+    return;
+  }
+
+  evict(shard, bytes);
+
+  size_t slot;
+  if (shard.freeEntries.empty()) {
+    slot = shard.entries.size();
+    shard.entries.push_back(Entry());
+  } else {
+    slot = shard.freeEntries.back();
+    shard.freeEntries.pop_back();
+  }
+
+  Entry& entry = shard.entries[slot];
+  entry.key = key;
+  entry.referenced = false;
+  entry.list = list;
+  shard.index[key] = slot;
+  shard.usedBytes += bytes;
+}
+
+size_t DecodedListCache::UsedBytes() {
+  size_t used = 0;
+
+  for (std::unique_ptr<Shard>& shard : _shards) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    used += shard->usedBytes;
+  }
+
+  return used;
+}
@@ -0,0 +1,59 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#ifndef INTCOMPBENCH_LISTCACHE_H_
+#define INTCOMPBENCH_LISTCACHE_H_
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Cache of decoded lists, shared by many threads, that holds at most
+// `budgetInBytes` bytes of integers. The keys are split into shards, each one
+// with its own lock and its own share of the budget, and evicted with the
+// CLOCK algorithm: a hit only sets the reference bit of the entry, and the
+// hand clears the bits until it finds an entry that has not been referenced
+// since it last went by. Lists are returned as shared pointers, so an evicted
+// list stays valid for the threads that are still using it.
+class DecodedListCache {
+public:
+  typedef std::shared_ptr<const std::vector<uint32_t> > List;
+
+private:
+  struct Entry {
+    uint32_t key;
+    bool referenced;
+    List list;
+  };
+
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<uint32_t, size_t> index;
+    std::vector<Entry> entries;
+    std::vector<size_t> freeEntries;
+    size_t hand;
+    size_t usedBytes;
+  };
+
+  std::vector<std::unique_ptr<Shard> > _shards;
+  size_t _shardBudget;
+
+  DecodedListCache(const DecodedListCache&);
+  DecodedListCache& operator=(const DecodedListCache&);
+
+  Shard& shardOf(uint32_t key);
+  void evict(Shard& shard, size_t bytes);
+
+public:
+  DecodedListCache(size_t budgetInBytes, size_t numShards);
+
+  // Returns the list, or an empty pointer if it is not in the cache.
+  List Get(uint32_t key);
+  // Adds a list. Lists larger than the budget of a shard are not cached.
+  void Insert(uint32_t key, const List& list);
+  size_t UsedBytes();
+};
+
+#endif // INTCOMPBENCH_LISTCACHE_H_
@@ -0,0 +1,266 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#include "listunion.h"
+
+#include <smmintrin.h>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+// Shuffles that move the lanes not flagged in the index to the front.
+struct UniqueShuffles {
+  __m128i masks[16];
+
+  UniqueShuffles() {
+    for (int duplicates = 0; duplicates < 16; ++duplicates) {
+      uint8_t bytes[16];
+      int next = 0;
+
+      std::memset(bytes, 0x80, sizeof(bytes));
+      for (int lane = 0; lane < 4; ++lane) {
+        if (!(duplicates & (1 << lane))) {
+          for (int b = 0; b < 4; ++b) {
+            bytes[next * 4 + b] = static_cast<uint8_t>(lane * 4 + b);
+          }
+          next++;
+        }
+      }
+
+      masks[duplicates] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes));
+    }
+  }
+};
+
+static const UniqueShuffles uniqueShuffles;
+
+// Merges two sorted vectors: `low` gets the four smallest integers and `high`
+// the four greatest, both sorted.
+static inline void mergeVectors(__m128i a, __m128i b, __m128i& low, __m128i& high) {
+  __m128i tmp = _mm_min_epu32(a, b);
+  high = _mm_max_epu32(a, b);
+
+  for (int i = 0; i < 3; ++i) {
+    tmp = _mm_alignr_epi8(tmp, tmp, 4);
+    low = _mm_min_epu32(tmp, high);
+    high = _mm_max_epu32(tmp, high);
+    tmp = low;
+  }
+
+  low = _mm_alignr_epi8(low, low, 4);
+}
+
+// Writes the integers of `values` that are not equal to the one before them,
+// the first one being compared with the last integer of `previous`. Always
+// stores four integers. Returns the number of integers written.
+static inline size_t storeUnique(__m128i previous, __m128i values, uint32_t *out) {
+  const __m128i shifted = _mm_alignr_epi8(values, previous, 12);
+  const int duplicates = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(shifted, values)));
+
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm_shuffle_epi8(values, uniqueShuffles.masks[duplicates]));
+  return 4 - __builtin_popcount(duplicates);
+}
+
+// Appends the union of a and b to the `length` integers already in `out`,
+// skipping every integer equal to the last one written.
+static size_t scalarUnion(const uint32_t *a, size_t lengthA, const uint32_t *b, size_t lengthB, uint32_t *out, size_t length) {
+  size_t i = 0, j = 0;
+
+  while (i < lengthA || j < lengthB) {
+    uint32_t value;
+
+    if (j == lengthB || (i < lengthA && a[i] < b[j])) {
+      value = a[i++];
+    } else if (i == lengthA || b[j] < a[i]) {
+      value = b[j++];
+    } else {
+      value = a[i++];
+      j++;
+    }
+
+    if (length == 0 || out[length - 1] != value) {
+      out[length++] = value;
+    }
+  }
+
+  return length;
+}
+
+size_t SIMDUnion(const uint32_t *a, size_t lengthA, const uint32_t *b, size_t lengthB, uint32_t *out) {
+  if (lengthA < 4 || lengthB < 4) {
+    return scalarUnion(a, lengthA, b, lengthB, out, 0);
+  }
+
+  const size_t endA = lengthA & ~size_t(3);
+  const size_t endB = lengthB & ~size_t(3);
+  size_t i = 4, j = 4;
+  __m128i low, high;
+
+  mergeVectors(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a)),
+    _mm_loadu_si128(reinterpret_cast<const __m128i *>(b)), low, high);
+
+  // The first integer is compared with one that cannot be equal to it.
+  size_t length = storeUnique(_mm_set1_epi32(std::min(a[0], b[0]) - 1), low, out);
+  __m128i last = low;
+
+  if (i < endA && j < endB) {
+    __m128i next;
+
+    // The vector with the smallest head goes next, so that every integer
+    // that is written is not greater than the ones still to be loaded.
+    while (true) {
+      if (a[i] <= b[j]) {
+        next = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+        i += 4;
+        if (i == endA) break;
+      } else {
+        next = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + j));
+        j += 4;
+        if (j == endB) break;
+      }
+
+      mergeVectors(next, high, low, high);
+      length += storeUnique(last, low, out + length);
+      last = low;
+    }
+
+    mergeVectors(next, high, low, high);
+    length += storeUnique(last, low, out + length);
+  }
+
+  // What is left: the greatest vector, the integers of the list whose
+  // vectors are exhausted that do not fill a vector, and the rest of the
+  // other list.
+  uint32_t buffer[8];
+  size_t bufferLength = 4;
+
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(buffer), high);
+
+  if (i == endA) {
+    bufferLength = std::copy(a + i, a + lengthA, buffer + 4) - buffer;
+    std::inplace_merge(buffer, buffer + 4, buffer + bufferLength);
+    return scalarUnion(buffer, bufferLength, b + j, lengthB - j, out, length);
+  } else {
+    bufferLength = std::copy(b + j, b + lengthB, buffer + 4) - buffer;
+    std::inplace_merge(buffer, buffer + 4, buffer + bufferLength);
+    return scalarUnion(buffer, bufferLength, a + i, lengthA - i, out, length);
+  }
+}
+
+size_t ListUnion::HeapMerge(const std::vector<SortedList>& lists, uint32_t *out) {
+  typedef std::pair<uint32_t, size_t> Head;
+  std::priority_queue<Head, std::vector<Head>, std::greater<Head> > heap;
+  size_t length = 0;
+
+  _positions.assign(lists.size(), 0);
+
+  for (size_t l = 0; l < lists.size(); ++l) {
+    if (lists[l].length > 0) {
+      heap.push(Head(lists[l].data[0], l));
+    }
+  }
+
+  while (!heap.empty()) {
+    const Head head = heap.top();
+    const size_t l = head.second;
+    const size_t position = ++_positions[l];
+
+    heap.pop();
+
+    if (length == 0 || out[length - 1] != head.first) {
+      out[length++] = head.first;
+    }
+
+    if (position < lists[l].length) {
+      heap.push(Head(lists[l].data[position], l));
+    }
+  }
+
+  return length;
+}
+
+size_t ListUnion::SIMDMerge(const std::vector<SortedList>& lists, uint32_t *out) {
+  size_t totalLength = 0;
+
+  for (const SortedList& list : lists) {
+    totalLength += list.length;
+  }
+
+  if (lists.empty()) {
+    return 0;
+  }
+
+  if (lists.size() == 1) {
+    std::copy(lists[0].data, lists[0].data + lists[0].length, out);
+    return lists[0].length;
+  }
+
+  // Every round reads the unions of the previous round and writes to the
+  // other buffer, except the last one, which writes to `out`.
+  std::vector<SortedList> current(lists);
+  std::vector<SortedList> next;
+  int target = 0;
+
+  _buffers[0].resize(totalLength);
+  _buffers[1].resize(totalLength);
+
+  while (current.size() > 1) {
+    uint32_t *dest = (current.size() == 2) ? out : _buffers[target].data();
+
+    next.clear();
+
+    for (size_t l = 0; l + 1 < current.size(); l += 2) {
+      const size_t length = SIMDUnion(current[l].data, current[l].length,
+        current[l + 1].data, current[l + 1].length, dest);
+      next.push_back(SortedList{dest, length});
+      dest += length;
+    }
+
+    if (current.size() % 2) {
+      const SortedList& odd = current.back();
+      std::copy(odd.data, odd.data + odd.length, dest);
+      next.push_back(SortedList{dest, odd.length});
+    }
+
+    current.swap(next);
+    target ^= 1;
+  }
+
+  return current[0].length;
+}
+
+size_t ListUnion::Bitmap(const std::vector<SortedList>& lists, uint32_t *out) {
+  uint32_t maxValue = 0;
+
+  for (const SortedList& list : lists) {
+    if (list.length > 0) {
+      maxValue = std::max(maxValue, list.data[list.length - 1]);
+    }
+  }
+
+  _bitmap.assign((size_t(maxValue) >> 6) + 1, 0);
+
+  for (const SortedList& list : lists) {
+    for (size_t i = 0; i < list.length; ++i) {
+      _bitmap[list.data[i] >> 6] |= uint64_t(1) << (list.data[i] & 63);
+    }
+  }
+
+  size_t length = 0;
+
+  for (size_t w = 0; w < _bitmap.size(); ++w) {
+    uint64_t word = _bitmap[w];
+
+    while (word) {
+      out[length++] = static_cast<uint32_t>((w << 6) + __builtin_ctzll(word));
+      word &= word - 1;
+    }
+  }
+
+  return length;
+}
@@ -0,0 +1,44 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#ifndef INTCOMPBENCH_LISTUNION_H_
+#define INTCOMPBENCH_LISTUNION_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A sorted list without repeated values.
+struct SortedList {
+  const uint32_t *data;
+  size_t length;
+};
+
+// Union of two sorted lists with an SSE merging network: four integers are
+// merged at a time and the repeated ones are removed with a shuffle. `out`
+// must have room for lengthA + lengthB integers. Returns the length of the
+// union.
+size_t SIMDUnion(const uint32_t *a, size_t lengthA, const uint32_t *b, size_t lengthB, uint32_t *out);
+
+// Union of many sorted lists. Every method writes the union to `out`, which
+// must have room for the sum of the lengths of the lists, and returns its
+// length. The scratch buffers are kept between calls.
+class ListUnion {
+private:
+  std::vector<uint32_t> _buffers[2];
+  std::vector<size_t> _positions;
+  std::vector<uint64_t> _bitmap;
+
+public:
+  // Merges all the lists at once with a binary heap of their heads.
+  size_t HeapMerge(const std::vector<SortedList>& lists, uint32_t *out);
+  // Merges the lists two by two with SIMDUnion, in log2(k) rounds.
+  size_t SIMDMerge(const std::vector<SortedList>& lists, uint32_t *out);
+  // Sets the bit of every integer in a bitmap as large as the greatest one,
+  // and then reads the bitmap back. Its cost depends on the size of the
+  // bitmap, so it pays off when the union is dense.
+  size_t Bitmap(const std::vector<SortedList>& lists, uint32_t *out);
+};
+
+#endif // INTCOMPBENCH_LISTUNION_H_
@@ -0,0 +1,256 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#include "packedlists.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "common.h"
+#include "smalllist.h"
+
+#include "SIMDCompressionAndIntersection/include/codecs.h"
+#include "SIMDCompressionAndIntersection/include/variablebyte.h"
+
+ListStore::ListStore(SIMDCompressionLib::IntegerCODEC& codec, size_t blockSize)
+  : _codec(codec), _blockSize(blockSize)
+{
+}
+
+void ListStore::Build(const std::vector<std::vector<uint32_t> >& lists) {
+  std::vector<uint32_t> copyOfList;
+  std::vector<uint32_t> buffer;
+
+  _encoded.clear();
+  _offsets.clear();
+  _lengths.clear();
+
+  for (const std::vector<uint32_t>& list : lists) {
+    // Codecs are allowed to modify their input.
+    copyOfList.assign(list.begin(), list.end());
+    buffer.resize(list.size() + 1024);
+
+    size_t encodedLength = EncodeWithFallback(_codec, _fallbackCodec, _blockSize,
+      copyOfList.data(), copyOfList.size(), buffer.data(), buffer.size());
+
+    _offsets.push_back(static_cast<uint32_t>(_encoded.size()));
+    _lengths.push_back(static_cast<uint32_t>(list.size()));
+    _encoded.insert(_encoded.end(), buffer.begin(), buffer.begin() + encodedLength);
+  }
+
+  _offsets.push_back(static_cast<uint32_t>(_encoded.size()));
+}
+
+size_t ListStore::NumLists() {
+  return _lengths.size();
+}
+
+size_t ListStore::ListLength(size_t index) {
+  return _lengths[index];
+}
+
+size_t ListStore::Decode(size_t index, uint32_t *out) {
+  return Decode(index, out, _codec);
+}
+
+size_t ListStore::Decode(size_t index, uint32_t *out, SIMDCompressionLib::IntegerCODEC& codec) {
+  SIMDCompressionLib::VByte<true> fallbackCodec;
+
+  DecodeWithFallback(codec, fallbackCodec, _blockSize,
+    _encoded.data() + _offsets[index], _offsets[index + 1] - _offsets[index], out, _lengths[index]);
+
+  return _lengths[index];
+}
+
+size_t ListStore::DecodeAll(uint32_t *out) {
+  size_t count = 0;
+
+  for (size_t i = 0; i < _lengths.size(); ++i) {
+    count += Decode(i, out + count);
+  }
+
+  return count;
+}
+
+size_t ListStore::EncodedLengthInBytes() {
+  return _encoded.size() * sizeof(uint32_t) + DirectoryLengthInBytes();
+}
+
+size_t ListStore::DirectoryLengthInBytes() {
+  return (_offsets.size() + _lengths.size()) * sizeof(uint32_t);
+}
+
+PackedListStore::PackedListStore(
+  SIMDCompressionLib::IntegerCODEC& codec,
+  size_t blockSize,
+  size_t pageLength): _codec(codec), _blockSize(blockSize), _pageLength(pageLength), _numLists(0)
+{
+}
+
+void PackedListStore::addPage(std::vector<uint32_t>& values, std::vector<uint32_t>& positions, size_t firstList) {
+  std::vector<uint32_t> buffer(values.size() + 1024);
+  DeltaBitPacking directoryCodec;
+  Page page;
+
+  page.offset = static_cast<uint32_t>(_encoded.size());
+  page.firstList = static_cast<uint32_t>(firstList);
+  page.length = static_cast<uint32_t>(values.size());
+  page.directoryOffset = static_cast<uint32_t>(_directory.size());
+
+  size_t encodedLength = EncodeWithFallback(_codec, _fallbackCodec, _blockSize,
+    values.data(), values.size(), buffer.data(), buffer.size());
+  _encoded.insert(_encoded.end(), buffer.begin(), buffer.begin() + encodedLength);
+
+  // The starting positions of the lists are increasing, so they are stored
+  // with the small-list codec.
+  buffer.resize(positions.size() + 2);
+  encodedLength = buffer.size();
+  directoryCodec.encodeArray(positions.data(), positions.size(), buffer.data(), encodedLength);
+  _directory.insert(_directory.end(), buffer.begin(), buffer.begin() + encodedLength);
+
+  _pages.push_back(page);
+}
+
+void PackedListStore::Build(const std::vector<std::vector<uint32_t> >& lists) {
+  std::vector<uint32_t> values;
+  std::vector<uint32_t> positions;
+  size_t firstList = 0;
+  uint64_t base = 0;
+
+  _encoded.clear();
+  _pages.clear();
+  _directory.clear();
+  _numLists = lists.size();
+
+  for (size_t i = 0; i < lists.size(); ++i) {
+    const std::vector<uint32_t>& list = lists[i];
+
+    if (list.empty()) {
+      throw std::logic_error("empty lists cannot be packed");
+    }
+
+    bool overflow = (base + list.back()) > std::numeric_limits<uint32_t>::max();
+    bool full = (values.size() + list.size()) > _pageLength;
+
+    if (!values.empty() && (overflow || full)) {
+      addPage(values, positions, firstList);
+      values.clear();
+      positions.clear();
+      firstList = i;
+      base = 0;
+    }
+
+    positions.push_back(static_cast<uint32_t>(values.size()));
+    for (uint32_t value : list) {
+      values.push_back(static_cast<uint32_t>(base + value));
+    }
+    base = uint64_t(values.back()) + 1;
+  }
+
+  if (!values.empty()) {
+    addPage(values, positions, firstList);
+  }
+
+  size_t maxPageLength = 0, maxListsInPage = 0;
+  for (size_t p = 0; p < _pages.size(); ++p) {
+    maxPageLength = std::max(maxPageLength, static_cast<size_t>(_pages[p].length));
+    maxListsInPage = std::max(maxListsInPage, numListsInPage(p));
+  }
+  _pageBuffer.resize(maxPageLength);
+  _positionsBuffer.reserve(maxListsInPage);
+}
+
+size_t PackedListStore::NumLists() {
+  return _numLists;
+}
+
+size_t PackedListStore::NumPages() {
+  return _pages.size();
+}
+
+size_t PackedListStore::numListsInPage(size_t page) {
+  return ((page + 1 < _pages.size()) ? _pages[page + 1].firstList : _numLists) - _pages[page].firstList;
+}
+
+void PackedListStore::decodePage(size_t page, uint32_t *values, std::vector<uint32_t>& positions) {
+  DeltaBitPacking directoryCodec;
+  const Page& p = _pages[page];
+  size_t encodedEnd = (page + 1 < _pages.size()) ? _pages[page + 1].offset : _encoded.size();
+
+  DecodeWithFallback(_codec, _fallbackCodec, _blockSize,
+    _encoded.data() + p.offset, encodedEnd - p.offset, values, p.length);
+
+  positions.resize(numListsInPage(page));
+  size_t numPositions = positions.size();
+  directoryCodec.decodeArray(_directory.data() + p.directoryOffset,
+    _directory.size() - p.directoryOffset, positions.data(), numPositions);
+}
+
+size_t PackedListStore::Decode(size_t index, uint32_t *out) {
+  // The last page whose first list is not after the given one.
+  size_t low = 0, high = _pages.size();
+  while (high - low > 1) {
+    const size_t middle = low + (high - low) / 2;
+    if (_pages[middle].firstList <= index) {
+      low = middle;
+    } else {
+      high = middle;
+    }
+  }
+
+  const Page& page = _pages[low];
+  uint32_t *values = _pageBuffer.data();
+  std::vector<uint32_t>& positions = _positionsBuffer;
+
+  decodePage(low, values, positions);
+
+  const size_t l = index - page.firstList;
+  const size_t start = positions[l];
+  const size_t end = (l + 1 < positions.size()) ? positions[l + 1] : page.length;
+  const uint32_t base = (l > 0) ? values[start - 1] + 1 : 0;
+
+  for (size_t i = start; i < end; ++i) {
+    out[i - start] = values[i] - base;
+  }
+
+  return end - start;
+}
+
+size_t PackedListStore::DecodeAll(uint32_t *out) {
+  std::vector<uint32_t>& positions = _positionsBuffer;
+  size_t count = 0;
+
+  for (size_t p = 0; p < _pages.size(); ++p) {
+    uint32_t *values = out + count;
+
+    decodePage(p, values, positions);
+
+    // Remove the shift of every list. It goes backwards because the shift of a
+    // list comes from the last value of the previous one, which must not have
+    // been restored yet.
+    size_t end = _pages[p].length;
+    for (size_t l = positions.size(); l-- > 1; ) {
+      const size_t start = positions[l];
+      const uint32_t base = values[start - 1] + 1;
+      for (size_t i = start; i < end; ++i) {
+        values[i] -= base;
+      }
+      end = start;
+    }
+
+    count += _pages[p].length;
+  }
+
+  return count;
+}
+
+size_t PackedListStore::EncodedLengthInBytes() {
+  return _encoded.size() * sizeof(uint32_t) + DirectoryLengthInBytes();
+}
+
+size_t PackedListStore::DirectoryLengthInBytes() {
+  return _pages.size() * sizeof(Page) + _directory.size() * sizeof(uint32_t);
+}
@@ -0,0 +1,90 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#ifndef INTCOMPBENCH_PACKEDLISTS_H_
+#define INTCOMPBENCH_PACKEDLISTS_H_
+
+#include <vector>
+
+#include "SIMDCompressionAndIntersection/include/codecs.h"
+#include "SIMDCompressionAndIntersection/include/variablebyte.h"
+
+// Stores every list on its own, one after the other. As in
+// SIMDCompressionUtil, the integers that fill whole blocks are encoded with
+// the codec and the rest with VByte<true>. The directory keeps a 32-bit offset
+// and a 32-bit length per list.
+class ListStore {
+private:
+  SIMDCompressionLib::VByte<true> _fallbackCodec;
+  SIMDCompressionLib::IntegerCODEC& _codec;
+  size_t _blockSize;
+  std::vector<uint32_t> _encoded;
+  std::vector<uint32_t> _offsets;
+  std::vector<uint32_t> _lengths;
+
+public:
+  ListStore(SIMDCompressionLib::IntegerCODEC& codec, size_t blockSize);
+
+  void Build(const std::vector<std::vector<uint32_t> >& lists);
+  size_t NumLists();
+  size_t ListLength(size_t index);
+  size_t Decode(size_t index, uint32_t *out);
+  // Same as above, but with the given instance of the codec, so that several
+  // threads can decode from the same store.
+  size_t Decode(size_t index, uint32_t *out, SIMDCompressionLib::IntegerCODEC& codec);
+  size_t DecodeAll(uint32_t *out);
+  size_t EncodedLengthInBytes();
+  size_t DirectoryLengthInBytes();
+};
+
+// Stores many short lists in shared pages, so that they do not pay a
+// per-list header and padding. The lists of a page are turned into a single
+// increasing sequence by adding to each list the last value of the previous
+// one plus one, and the page is encoded like a single list. A page is closed
+// when it reaches `pageLength` integers or when the next list would overflow
+// 32 bits. The directory keeps, for every page, its offset and its first list,
+// and the starting position of its lists encoded with DeltaBitPacking.
+class PackedListStore {
+private:
+  struct Page {
+    uint32_t offset;
+    uint32_t firstList;
+    uint32_t length;
+    uint32_t directoryOffset;
+  };
+
+  SIMDCompressionLib::VByte<true> _fallbackCodec;
+  SIMDCompressionLib::IntegerCODEC& _codec;
+  size_t _blockSize;
+  size_t _pageLength;
+  size_t _numLists;
+  std::vector<uint32_t> _encoded;
+  std::vector<Page> _pages;
+  std::vector<uint32_t> _directory;
+  // Scratch space for Decode(), sized by Build() for the largest page.
+  std::vector<uint32_t> _pageBuffer;
+  std::vector<uint32_t> _positionsBuffer;
+
+  void addPage(std::vector<uint32_t>& values, std::vector<uint32_t>& positions, size_t firstList);
+  size_t numListsInPage(size_t page);
+  // Decodes the page to `values` and the starting positions of its lists to
+  // `positions`, with the lists still shifted.
+  void decodePage(size_t page, uint32_t *values, std::vector<uint32_t>& positions);
+
+public:
+  PackedListStore(SIMDCompressionLib::IntegerCODEC& codec, size_t blockSize, size_t pageLength);
+
+  void Build(const std::vector<std::vector<uint32_t> >& lists);
+  size_t NumLists();
+  size_t NumPages();
+  // Decodes the page that holds the given list and copies the list to `out`.
+  // Returns the length of the list. It decodes to buffers of the store, so,
+  // unlike ListStore, it cannot be called from several threads at once.
+  size_t Decode(size_t index, uint32_t *out);
+  size_t DecodeAll(uint32_t *out);
+  size_t EncodedLengthInBytes();
+  size_t DirectoryLengthInBytes();
+};
+
+#endif // INTCOMPBENCH_PACKEDLISTS_H_
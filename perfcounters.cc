@@ -0,0 +1,87 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#include "perfcounters.h"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstring>
+
+static int openDTLBEvent(uint64_t result, int groupFd) {
+  struct perf_event_attr attr;
+
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HW_CACHE;
+  attr.config = PERF_COUNT_HW_CACHE_DTLB |
+    (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+    (result << 16);
+  attr.disabled = (groupFd == -1) ? 1 : 0;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+
+  return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0));
+}
+
+static uint64_t readEvent(int fd) {
+  uint64_t value = 0;
+
+  if (read(fd, &value, sizeof(value)) != sizeof(value)) {
+    return 0;
+  }
+
+  return value;
+}
+
+TLBCounters::TLBCounters() {
+  _accessesFd = openDTLBEvent(PERF_COUNT_HW_CACHE_RESULT_ACCESS, -1);
+  _missesFd = (_accessesFd == -1) ? -1 : openDTLBEvent(PERF_COUNT_HW_CACHE_RESULT_MISS, _accessesFd);
+
+  if (_missesFd == -1 && _accessesFd != -1) {
+    close(_accessesFd);
+    _accessesFd = -1;
+  }
+}
+
+TLBCounters::~TLBCounters() {
+  if (_missesFd != -1) close(_missesFd);
+  if (_accessesFd != -1) close(_accessesFd);
+}
+
+bool TLBCounters::Available() {
+  return _accessesFd != -1;
+}
+
+void TLBCounters::Start() {
+  if (!Available()) return;
+
+  ioctl(_accessesFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(_accessesFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void TLBCounters::Pause() {
+  if (!Available()) return;
+
+  ioctl(_accessesFd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void TLBCounters::Resume() {
+  if (!Available()) return;
+
+  ioctl(_accessesFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void TLBCounters::Stop(uint64_t& accesses, uint64_t& misses) {
+  accesses = 0;
+  misses = 0;
+
+  if (!Available()) return;
+
+  ioctl(_accessesFd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+  accesses = readEvent(_accessesFd);
+  misses = readEvent(_missesFd);
+}
@@ -0,0 +1,37 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#ifndef INTCOMPBENCH_PERFCOUNTERS_H_
+#define INTCOMPBENCH_PERFCOUNTERS_H_
+
+#include <cstdint>
+
+// Counts data TLB load accesses and misses of the calling thread through the
+// Linux perf_event_open(2) interface. When the events cannot be opened (no
+// hardware support, virtualised PMU or a restrictive perf_event_paranoid),
+// the counters are not available and no measurement is reported.
+class TLBCounters {
+private:
+  int _accessesFd;
+  int _missesFd;
+
+  TLBCounters(const TLBCounters&);
+  TLBCounters& operator=(const TLBCounters&);
+
+public:
+  TLBCounters();
+  ~TLBCounters();
+
+  bool Available();
+
+  // Resets the counters and starts counting.
+  void Start();
+  // Leave the events from Pause() to Resume() out of the counts.
+  void Pause();
+  void Resume();
+  // Stops counting and returns the counts since Start().
+  void Stop(uint64_t& accesses, uint64_t& misses);
+};
+
+#endif // INTCOMPBENCH_PERFCOUNTERS_H_
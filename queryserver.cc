@@ -0,0 +1,183 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common.h"
+#include "listcache.h"
+#include "packedlists.h"
+
+#include "benchmark/include/benchmark/benchmark.h"
+#include "SIMDCompressionAndIntersection/include/codecs.h"
+
+// Lists of gov2.sorted served by the query server simulation: a random
+// sample of this many lists whose length is in [minListLength,
+// maxListLength), which bounds the memory taken by the uncompressed lists.
+static const size_t sampleSize = 100000;
+static const size_t minListLength = 128;
+static const size_t maxListLength = 1 << 16;
+
+// Every client issues this many lookups per iteration.
+static const size_t queriesPerClient = 20000;
+
+// Skew of the lookups.
+static const double zipfExponent = 1.0;
+
+static const size_t numCacheShards = 64;
+
+class Gov2QueryServer : public benchmark::Fixture {
+public:
+  static std::vector<std::vector<uint32_t> > lists;
+
+  void SetUp(const ::benchmark::State& state) {
+    if (lists.empty()) {
+      SampleGov2SortedSets(lists, minListLength, maxListLength, sampleSize, 5);
+    }
+  }
+
+  void TearDown(const ::benchmark::State& state) {}
+};
+
+std::vector<std::vector<uint32_t> > Gov2QueryServer::lists = std::vector<std::vector<uint32_t> >();
+
+struct ClientStats {
+  LatencyHistogram latencies;
+  uint64_t hits;
+  uint64_t misses;
+
+  ClientStats(): hits(0), misses(0) {}
+};
+
+// Looks up the lists of `queries`: from the cache if they are there, otherwise
+// decoded from the store and added to the cache. Every client has its own
+// instance of the codec.
+static void runClient(
+  ListStore& store,
+  DecodedListCache& cache,
+  const CodecDescriptor& desc,
+  const std::vector<uint32_t>& queries,
+  ClientStats& stats)
+{
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = desc.create();
+
+  for (uint32_t listIndex : queries) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    DecodedListCache::List list = cache.Get(listIndex);
+
+    if (list) {
+      stats.hits++;
+    } else {
+      std::shared_ptr<std::vector<uint32_t> > decoded(new std::vector<uint32_t>(store.ListLength(listIndex)));
+      store.Decode(listIndex, decoded->data(), *codec);
+      list = decoded;
+      cache.Insert(listIndex, list);
+      stats.misses++;
+    }
+
+    benchmark::DoNotOptimize(list->back());
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    stats.latencies.Add(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+  }
+}
+
+// Arguments: number of client threads and cache budget in MB (0 disables the
+// cache). The popularity of the lists follows a Zipf distribution over a
+// random permutation of the lists, so that it does not depend on their order
+// in the file.
+static void benchmarkQueryServer(Gov2QueryServer* obj, const CodecDescriptor& desc, benchmark::State& state) {
+  std::vector<std::vector<uint32_t> >& lists = Gov2QueryServer::lists;
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = desc.create();
+  if (!codec) {
+    state.SkipWithError("codec not available");
+    return;
+  }
+  const size_t numClients = state.range(0);
+  const size_t cacheBudget = size_t(state.range(1)) << 20;
+  ListStore store(*codec, desc.blockSize);
+  DecodedListCache cache(cacheBudget, numCacheShards);
+
+  store.Build(lists);
+
+  std::mt19937 generator(1234);
+  std::vector<uint32_t> permutation(lists.size());
+  std::iota(permutation.begin(), permutation.end(), 0);
+  std::shuffle(permutation.begin(), permutation.end(), generator);
+
+  ZipfDistribution zipf(lists.size(), zipfExponent);
+  std::vector<std::vector<uint32_t> > queries(numClients, std::vector<uint32_t>(queriesPerClient));
+
+  for (std::vector<uint32_t>& clientQueries : queries) {
+    for (uint32_t& query : clientQueries) {
+      query = permutation[zipf(generator)];
+    }
+  }
+
+  // Warms up the cache before measuring.
+  ClientStats warmUpStats;
+  runClient(store, cache, desc, queries[0], warmUpStats);
+
+  std::vector<ClientStats> stats(numClients);
+
+  for (auto _ : state) {
+    std::vector<std::thread> clients;
+
+    for (size_t c = 0; c < numClients; ++c) {
+      clients.push_back(std::thread(runClient, std::ref(store), std::ref(cache),
+        std::cref(desc), std::cref(queries[c]), std::ref(stats[c])));
+    }
+
+    for (std::thread& client : clients) {
+      client.join();
+    }
+  }
+
+  ClientStats total;
+
+  for (const ClientStats& clientStats : stats) {
+    total.latencies.Merge(clientStats.latencies);
+    total.hits += clientStats.hits;
+    total.misses += clientStats.misses;
+  }
+
+  size_t inputLength = 0;
+  for (const std::vector<uint32_t>& list : lists) {
+    inputLength += list.size() * sizeof(uint32_t);
+  }
+
+  state.counters["qps"] = benchmark::Counter(double(total.hits + total.misses), benchmark::Counter::kIsRate);
+  state.counters["hitRate"] = double(total.hits) / double(total.hits + total.misses);
+  state.counters["p50Ns"] = total.latencies.Percentile(50);
+  state.counters["p99Ns"] = total.latencies.Percentile(99);
+  state.counters["maxNs"] = total.latencies.Max();
+  state.counters["lists"] = lists.size();
+  state.counters["encodedLength"] = store.EncodedLengthInBytes();
+  state.counters["compressionRatio"] = double(inputLength) / double(store.EncodedLengthInBytes());
+  state.counters["cacheUsed"] = cache.UsedBytes();
+}
+
+static void registerQueryServerBenchmark(const CodecDescriptor& codec) {
+  benchmark::internal::RegisterBenchmarkInternal(
+    new CodecBenchmark<Gov2QueryServer>("Gov2QueryServer/" + codec.name, codec, benchmarkQueryServer))
+    ->ArgsProduct({{1, 4, 16}, {0, 16, 256}})
+    ->UseRealTime();
+}
+
+static bool registerBenchmarks() {
+  registerQueryServerBenchmark(VTEncCodecDescriptor());
+
+  for (const CodecDescriptor& codec : CodecTable()) {
+    registerQueryServerBenchmark(codec);
+  }
+
+  return true;
+}
+
+static bool benchmarksRegistered = registerBenchmarks();
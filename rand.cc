@@ -5,17 +5,20 @@
 #include <algorithm>
 #include <iostream>
 #include <limits>
+#include <memory>
 #include <random>
+#include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "blockiterator.h"
+#include "colddecode.h"
 #include "common.h"
+#include "updatableset.h"
 
 #include "benchmark/include/benchmark/benchmark.h"
-#include "SIMDCompressionAndIntersection/include/binarypacking.h"
-#include "SIMDCompressionAndIntersection/include/fastpfor.h"
-#include "SIMDCompressionAndIntersection/include/variablebyte.h"
-#include "SIMDCompressionAndIntersection/include/varintgb.h"
+#include "SIMDCompressionAndIntersection/include/codecs.h"
 #include "VTEnc/vtenc.h"
 
 class RandomUniform32 : public benchmark::Fixture {
@@ -62,9 +65,9 @@ static void benchmarkEncode(SIMDCompressionUtil& comp, benchmark::State& state)
   CompressionStats stats(state);
 
   for (auto _ : state) {
-    state.PauseTiming();
+    stats.PauseTiming();
     comp.Reset();
-    state.ResumeTiming();
+    stats.ResumeTiming();
 
     comp.Encode();
   }
@@ -75,26 +78,26 @@ static void benchmarkEncode(SIMDCompressionUtil& comp, benchmark::State& state)
 }
 
 static void benchmarkDecode(SIMDCompressionUtil& comp, benchmark::State& state) {
-  CompressionStats stats(state);
-
   comp.Encode();
 
+  CompressionStats stats(state);
+
   for (auto _ : state) {
     comp.Decode();
   }
 
-  comp.EqualityCheck();
-
   stats.SetInputLengthInBytes(comp.InputLength() * sizeof(uint32_t));
   stats.SetEncodedLengthInBytes(comp.EncodedLength() * sizeof(uint32_t));
   stats.SetFinalStats();
+
+  comp.EqualityCheck();
 }
 
 BENCHMARK_DEFINE_F(RandomUniform32, Copy)(benchmark::State& state) {
-  CompressionStats stats(state);
   size_t len = state.range(0);
   std::vector<uint32_t> &data = dist_map[len];
   std::vector<uint32_t> copyTo(data.size());
+  CompressionStats stats(state);
 
   for (auto _ : state)
     std::copy(data.begin(), data.end(), copyTo.begin());
@@ -105,11 +108,10 @@ BENCHMARK_DEFINE_F(RandomUniform32, Copy)(benchmark::State& state) {
 }
 
 BENCHMARK_DEFINE_F(RandomUniform32, VTEncEncode)(benchmark::State& state) {
-  CompressionStats stats(state);
   size_t len = state.range(0);
-  std::vector<uint32_t> &data = dist_map[len];
+  HugePageVector<uint32_t> data(dist_map[len].begin(), dist_map[len].end());
   size_t encodedLength = 0;
-  std::vector<uint8_t> encoded(vtenc_max_encoded_size32(data.size()));
+  HugePageVector<uint8_t> encoded(vtenc_max_encoded_size32(data.size()));
   vtenc *encoder = vtenc_create();
   assert(encoder != NULL);
 
@@ -117,6 +119,8 @@ BENCHMARK_DEFINE_F(RandomUniform32, VTEncEncode)(benchmark::State& state) {
   vtenc_config(encoder, VTENC_CONFIG_SKIP_FULL_SUBTREES, 1);
   vtenc_config(encoder, VTENC_CONFIG_MIN_CLUSTER_LENGTH, 1);
 
+  CompressionStats stats(state);
+
   for (auto _ : state)
     vtenc_encode32(encoder, data.data(), data.size(), encoded.data(), encoded.size());
 
@@ -130,10 +134,9 @@ BENCHMARK_DEFINE_F(RandomUniform32, VTEncEncode)(benchmark::State& state) {
 }
 
 BENCHMARK_DEFINE_F(RandomUniform32, VTEncDecode)(benchmark::State& state) {
-  CompressionStats stats(state);
   size_t len = state.range(0);
-  std::vector<uint32_t> &data = dist_map[len];
-  std::vector<uint8_t> encoded(vtenc_max_encoded_size32(data.size()));
+  HugePageVector<uint32_t> data(dist_map[len].begin(), dist_map[len].end());
+  HugePageVector<uint8_t> encoded(vtenc_max_encoded_size32(data.size()));
   vtenc *handler = vtenc_create();
   assert(handler != NULL);
 
@@ -144,100 +147,113 @@ BENCHMARK_DEFINE_F(RandomUniform32, VTEncDecode)(benchmark::State& state) {
   vtenc_encode32(handler, data.data(), data.size(), encoded.data(), encoded.size());
 
   size_t encodedLength = vtenc_encoded_size(handler);
-  std::vector<uint32_t> decoded(data.size());
+  HugePageVector<uint32_t> decoded(data.size());
+  CompressionStats stats(state);
 
   for (auto _ : state)
     vtenc_decode32(handler, encoded.data(), encodedLength, decoded.data(), decoded.size());
 
-  if (data != decoded) {
-    throw std::logic_error("equality check failed");
-  }
-
   stats.SetInputLengthInBytes(data.size() * sizeof(uint32_t));
   stats.SetEncodedLengthInBytes(encodedLength);
   stats.SetFinalStats();
 
+  if (data != decoded) {
+    throw std::logic_error("equality check failed");
+  }
+
   vtenc_destroy(handler);
 }
 
-BENCHMARK_DEFINE_F(RandomUniform32, DeltaVariableByteEncode)(benchmark::State& state) {
+static void benchmarkCodecEncode(RandomUniform32* obj, const CodecDescriptor& desc, benchmark::State& state) {
   size_t len = state.range(0);
-  std::vector<uint32_t> &data = dist_map[len];
-  SIMDCompressionLib::VByte<true> codec;
-  SIMDCompressionUtil comp(codec, 1, data);
+  std::vector<uint32_t> &data = RandomUniform32::dist_map[len];
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = desc.create();
+  if (!codec) {
+    state.SkipWithError("codec not available");
+    return;
+  }
+  SIMDCompressionUtil comp(*codec, desc.blockSize, data);
   benchmarkEncode(comp, state);
 }
 
-BENCHMARK_DEFINE_F(RandomUniform32, DeltaVariableByteDecode)(benchmark::State& state) {
+static void benchmarkCodecDecode(RandomUniform32* obj, const CodecDescriptor& desc, benchmark::State& state) {
   size_t len = state.range(0);
-  std::vector<uint32_t> &data = dist_map[len];
-  SIMDCompressionLib::VByte<true> codec;
-  SIMDCompressionUtil comp(codec, 1, data);
+  std::vector<uint32_t> &data = RandomUniform32::dist_map[len];
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = desc.create();
+  if (!codec) {
+    state.SkipWithError("codec not available");
+    return;
+  }
+  SIMDCompressionUtil comp(*codec, desc.blockSize, data);
   benchmarkDecode(comp, state);
 }
 
-BENCHMARK_DEFINE_F(RandomUniform32, DeltaVarIntGBEncode)(benchmark::State& state) {
+// state.range(1) is the CacheLevel the working set fits in.
+static void benchmarkCodecDecodeCold(RandomUniform32* obj, const CodecDescriptor& desc, benchmark::State& state) {
   size_t len = state.range(0);
-  std::vector<uint32_t> &data = dist_map[len];
-  SIMDCompressionLib::VarIntGB<true> codec;
-  SIMDCompressionUtil comp(codec, 1, data);
-  benchmarkEncode(comp, state);
+  std::vector<uint32_t> &data = RandomUniform32::dist_map[len];
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = desc.create();
+  if (!codec) {
+    state.SkipWithError("codec not available");
+    return;
+  }
+  BenchmarkRotatingDecode(*codec, desc.blockSize, data, CacheLevel(state.range(1)), state);
 }
 
-BENCHMARK_DEFINE_F(RandomUniform32, DeltaVarIntGBDecode)(benchmark::State& state) {
+// state.range(1) is the FusedConsumer.
+static void benchmarkCodecScanFull(RandomUniform32* obj, const CodecDescriptor& desc, benchmark::State& state) {
   size_t len = state.range(0);
-  std::vector<uint32_t> &data = dist_map[len];
-  SIMDCompressionLib::VarIntGB<true> codec;
-  SIMDCompressionUtil comp(codec, 1, data);
-  benchmarkDecode(comp, state);
+  std::vector<std::vector<uint32_t> > lists(1, RandomUniform32::dist_map[len]);
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = desc.create();
+  if (!codec) {
+    state.SkipWithError("codec not available");
+    return;
+  }
+  BenchmarkFusedScan(*codec, desc.blockSize, lists, FusedConsumer(state.range(1)), 0, state);
 }
 
-BENCHMARK_DEFINE_F(RandomUniform32, DeltaBinaryPackingEncode)(benchmark::State& state) {
+// state.range(1) is the FusedConsumer and state.range(2) the block length.
+static void benchmarkCodecScanBlocks(RandomUniform32* obj, const CodecDescriptor& desc, benchmark::State& state) {
   size_t len = state.range(0);
-  std::vector<uint32_t> &data = dist_map[len];
-  SIMDCompressionLib::BinaryPacking<SIMDCompressionLib::BasicBlockPacker> codec;
-  SIMDCompressionUtil comp(codec, codec.BlockSize, data);
-  benchmarkEncode(comp, state);
+  std::vector<std::vector<uint32_t> > lists(1, RandomUniform32::dist_map[len]);
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = desc.create();
+  if (!codec) {
+    state.SkipWithError("codec not available");
+    return;
+  }
+  BenchmarkFusedScan(*codec, desc.blockSize, lists, FusedConsumer(state.range(1)), state.range(2), state);
 }
 
-BENCHMARK_DEFINE_F(RandomUniform32, DeltaBinaryPackingDecode)(benchmark::State& state) {
+// state.range(1) is the number of updates, in thousandths of the integers.
+static void benchmarkSetUpdates(const CodecDescriptor& desc, benchmark::State& state, SetUpdateBenchmark operation) {
   size_t len = state.range(0);
-  std::vector<uint32_t> &data = dist_map[len];
-  SIMDCompressionLib::BinaryPacking<SIMDCompressionLib::BasicBlockPacker> codec;
-  SIMDCompressionUtil comp(codec, codec.BlockSize, data);
-  benchmarkDecode(comp, state);
+  std::vector<std::vector<uint32_t> > lists(1, RandomUniform32::dist_map[len]);
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = desc.create();
+  if (!codec) {
+    state.SkipWithError("codec not available");
+    return;
+  }
+  BenchmarkSetUpdates(*codec, desc.blockSize, lists, operation, state.range(1), state);
 }
 
-BENCHMARK_DEFINE_F(RandomUniform32, DeltaFastPFor128Encode)(benchmark::State& state) {
-  size_t len = state.range(0);
-  std::vector<uint32_t> &data = dist_map[len];
-  SIMDCompressionLib::FastPFor<4, true> codec;
-  SIMDCompressionUtil comp(codec, codec.BlockSize, data);
-  benchmarkEncode(comp, state);
+static void benchmarkSetInsert(RandomUniform32* obj, const CodecDescriptor& desc, benchmark::State& state) {
+  benchmarkSetUpdates(desc, state, SET_UPDATE_INSERT);
 }
 
-BENCHMARK_DEFINE_F(RandomUniform32, DeltaFastPFor128Decode)(benchmark::State& state) {
-  size_t len = state.range(0);
-  std::vector<uint32_t> &data = dist_map[len];
-  SIMDCompressionLib::FastPFor<4, true> codec;
-  SIMDCompressionUtil comp(codec, codec.BlockSize, data);
-  benchmarkDecode(comp, state);
+static void benchmarkSetDelete(RandomUniform32* obj, const CodecDescriptor& desc, benchmark::State& state) {
+  benchmarkSetUpdates(desc, state, SET_UPDATE_DELETE);
 }
 
-BENCHMARK_DEFINE_F(RandomUniform32, DeltaFastPFor256Encode)(benchmark::State& state) {
-  size_t len = state.range(0);
-  std::vector<uint32_t> &data = dist_map[len];
-  SIMDCompressionLib::FastPFor<8, true> codec;
-  SIMDCompressionUtil comp(codec, codec.BlockSize, data);
-  benchmarkEncode(comp, state);
+static void benchmarkSetCompact(RandomUniform32* obj, const CodecDescriptor& desc, benchmark::State& state) {
+  benchmarkSetUpdates(desc, state, SET_UPDATE_COMPACT);
 }
 
-BENCHMARK_DEFINE_F(RandomUniform32, DeltaFastPFor256Decode)(benchmark::State& state) {
-  size_t len = state.range(0);
-  std::vector<uint32_t> &data = dist_map[len];
-  SIMDCompressionLib::FastPFor<8, true> codec;
-  SIMDCompressionUtil comp(codec, codec.BlockSize, data);
-  benchmarkDecode(comp, state);
+static void benchmarkSetRead(RandomUniform32* obj, const CodecDescriptor& desc, benchmark::State& state) {
+  benchmarkSetUpdates(desc, state, SET_UPDATE_READ);
+}
+
+static void benchmarkSetReadCompacted(RandomUniform32* obj, const CodecDescriptor& desc, benchmark::State& state) {
+  benchmarkSetUpdates(desc, state, SET_UPDATE_READ_COMPACTED);
 }
 
 BENCHMARK_REGISTER_F(RandomUniform32, Copy)
@@ -249,32 +265,56 @@ BENCHMARK_REGISTER_F(RandomUniform32, VTEncEncode)
 BENCHMARK_REGISTER_F(RandomUniform32, VTEncDecode)
   ->RangeMultiplier(10)->Range(100, 10000000);
 
-BENCHMARK_REGISTER_F(RandomUniform32, DeltaVariableByteEncode)
-  ->RangeMultiplier(10)->Range(100, 10000000);
-
-BENCHMARK_REGISTER_F(RandomUniform32, DeltaVariableByteDecode)
-  ->RangeMultiplier(10)->Range(100, 10000000);
+static bool registerCodecBenchmarks() {
+  for (auto b : RegisterCodecBenchmarks<RandomUniform32>("RandomUniform32", "Encode", benchmarkCodecEncode)) {
+    b->RangeMultiplier(10)->Range(100, 10000000);
+  }
 
-BENCHMARK_REGISTER_F(RandomUniform32, DeltaVarIntGBEncode)
-  ->RangeMultiplier(10)->Range(100, 10000000);
+  for (auto b : RegisterCodecBenchmarks<RandomUniform32>("RandomUniform32", "Decode", benchmarkCodecDecode)) {
+    b->RangeMultiplier(10)->Range(100, 10000000);
+  }
 
-BENCHMARK_REGISTER_F(RandomUniform32, DeltaVarIntGBDecode)
-  ->RangeMultiplier(10)->Range(100, 10000000);
+  for (auto b : RegisterCodecBenchmarks<RandomUniform32>("RandomUniform32", "DecodeCold", benchmarkCodecDecodeCold)) {
+    b->ArgsProduct({{1000, 100000, 1000000}, {CACHE_L1, CACHE_L2, CACHE_L3, CACHE_DRAM}});
+  }
 
-BENCHMARK_REGISTER_F(RandomUniform32, DeltaBinaryPackingEncode)
-  ->RangeMultiplier(10)->Range(100, 10000000);
+  benchmark::internal::RegisterBenchmarkInternal(
+    new CodecBenchmark<RandomUniform32>("RandomUniform32/VTEncDecodeCold", VTEncCodecDescriptor(), benchmarkCodecDecodeCold))
+    ->ArgsProduct({{1000, 100000, 1000000}, {CACHE_L1, CACHE_L2, CACHE_L3, CACHE_DRAM}});
 
-BENCHMARK_REGISTER_F(RandomUniform32, DeltaBinaryPackingDecode)
-  ->RangeMultiplier(10)->Range(100, 10000000);
+  for (auto b : RegisterCodecBenchmarks<RandomUniform32>("RandomUniform32", "ScanFull", benchmarkCodecScanFull)) {
+    b->ArgsProduct({{100000, 10000000}, {FUSED_SUM, FUSED_COUNT_IN_RANGE, FUSED_FILTER_BITMAP}});
+  }
+  benchmark::internal::RegisterBenchmarkInternal(
+    new CodecBenchmark<RandomUniform32>("RandomUniform32/VTEncScanFull", VTEncCodecDescriptor(), benchmarkCodecScanFull))
+    ->ArgsProduct({{100000, 10000000}, {FUSED_SUM, FUSED_COUNT_IN_RANGE, FUSED_FILTER_BITMAP}});
 
-BENCHMARK_REGISTER_F(RandomUniform32, DeltaFastPFor128Encode)
-  ->RangeMultiplier(10)->Range(100, 10000000);
+  for (auto b : RegisterCodecBenchmarks<RandomUniform32>("RandomUniform32", "ScanBlocks", benchmarkCodecScanBlocks)) {
+    b->ArgsProduct({{100000, 10000000}, {FUSED_SUM, FUSED_COUNT_IN_RANGE, FUSED_FILTER_BITMAP}, {128, 256}});
+  }
+  benchmark::internal::RegisterBenchmarkInternal(
+    new CodecBenchmark<RandomUniform32>("RandomUniform32/VTEncScanBlocks", VTEncCodecDescriptor(), benchmarkCodecScanBlocks))
+    ->ArgsProduct({{100000, 10000000}, {FUSED_SUM, FUSED_COUNT_IN_RANGE, FUSED_FILTER_BITMAP}, {128, 256}});
+
+  const std::vector<std::pair<std::string, CodecBenchmark<RandomUniform32>::Function> > setBenchmarks = {
+    {"SetInsert", benchmarkSetInsert},
+    {"SetDelete", benchmarkSetDelete},
+    {"SetCompact", benchmarkSetCompact},
+    {"SetRead", benchmarkSetRead},
+    {"SetReadCompacted", benchmarkSetReadCompacted}
+  };
+
+  for (const auto& method : setBenchmarks) {
+    for (auto b : RegisterCodecBenchmarks<RandomUniform32>("RandomUniform32", method.first, method.second)) {
+      b->ArgsProduct({{100000, 1000000}, {10, 500}});
+    }
 
-BENCHMARK_REGISTER_F(RandomUniform32, DeltaFastPFor128Decode)
-  ->RangeMultiplier(10)->Range(100, 10000000);
+    benchmark::internal::RegisterBenchmarkInternal(
+      new CodecBenchmark<RandomUniform32>("RandomUniform32/VTEnc" + method.first, VTEncCodecDescriptor(), method.second))
+      ->ArgsProduct({{100000, 1000000}, {10, 500}});
+  }
 
-BENCHMARK_REGISTER_F(RandomUniform32, DeltaFastPFor256Encode)
-  ->RangeMultiplier(10)->Range(100, 10000000);
+  return true;
+}
 
-BENCHMARK_REGISTER_F(RandomUniform32, DeltaFastPFor256Decode)
-  ->RangeMultiplier(10)->Range(100, 10000000);
+static bool codecBenchmarksRegistered = registerCodecBenchmarks();
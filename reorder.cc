@@ -0,0 +1,184 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#include "reorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bisection.h"
+#include "common.h"
+#include "packedlists.h"
+
+#include "SIMDCompressionAndIntersection/include/codecs.h"
+
+// Only the lists with at least this many integers are taken into account to
+// compute the permutation, and to compare the codecs.
+static const size_t minGraphListLength = 4096;
+
+// Times that the lists are decoded to measure the speed of a codec. The best
+// time is kept.
+static const size_t decodeRepetitions = 3;
+
+struct CodecResult {
+  double bitsPerInt;
+  // Millions of integers per second.
+  double decodeSpeed;
+};
+
+// The lists are decoded one at a time into a buffer as long as the longest
+// one, so that only the encoded lists are kept besides the original ones.
+static CodecResult measureCodec(
+  const CodecDescriptor& desc,
+  const std::vector<std::vector<uint32_t> >& lists,
+  size_t totalLength,
+  size_t maxLength)
+{
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = desc.create();
+  ListStore store(*codec, desc.blockSize);
+  std::vector<uint32_t> decoded(maxLength);
+  double bestSeconds = 0.0;
+
+  store.Build(lists);
+
+  for (size_t i = 0; i < lists.size(); ++i) {
+    if (store.Decode(i, decoded.data()) != lists[i].size() ||
+        !std::equal(lists[i].begin(), lists[i].end(), decoded.begin())) {
+      throw std::logic_error("equality check failed");
+    }
+  }
+
+  for (size_t r = 0; r < decodeRepetitions; ++r) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    size_t length = 0;
+
+    for (size_t i = 0; i < lists.size(); ++i) {
+      length += store.Decode(i, decoded.data());
+    }
+
+    double seconds = SecondsSince(start);
+
+    if (length != totalLength) {
+      throw std::logic_error("equality check failed");
+    }
+    bestSeconds = (r == 0) ? seconds : std::min(bestSeconds, seconds);
+  }
+
+  CodecResult result;
+  result.bitsPerInt = 8.0 * store.EncodedLengthInBytes() / totalLength;
+  result.decodeSpeed = totalLength / bestSeconds / 1e6;
+  return result;
+}
+
+static void writeList(std::ofstream& outFile, const std::vector<uint32_t>& list) {
+  const uint32_t length = static_cast<uint32_t>(list.size());
+
+  outFile.write(reinterpret_cast<const char *>(&length), sizeof(length));
+  outFile.write(reinterpret_cast<const char *>(list.data()), list.size() * sizeof(uint32_t));
+}
+
+void ReorderGov2(const std::string& outputName) {
+  if (outputName == GlobalState::gov2File) {
+    throw std::logic_error("the reordered lists cannot overwrite the input file");
+  }
+
+  const size_t numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+  std::vector<std::vector<uint32_t> > lists;
+  std::vector<uint32_t> data;
+  Gov2SortedFile file;
+  uint32_t numDocs = 0;
+  size_t numLists = 0;
+  size_t totalLength = 0;
+  size_t maxLength = 0;
+
+  file.Open(Gov2SortedPath());
+  while (file.LoadNextSet(data)) {
+    if (!data.empty()) {
+      numDocs = std::max(numDocs, data.back() + 1);
+    }
+    if (data.size() >= minGraphListLength) {
+      totalLength += data.size();
+      maxLength = std::max(maxLength, data.size());
+      lists.push_back(data);
+    }
+    numLists++;
+  }
+  file.Close();
+
+  std::cout << "Lists: " << numLists << ", documents: " << numDocs << std::endl;
+  std::cout << "Reordering with the " << lists.size() << " lists of at least "
+    << minGraphListLength << " integers (" << totalLength << " integers), "
+    << numThreads << " threads" << std::endl;
+
+  // The forward index of the bisection, as large as the lists, is freed as
+  // soon as the permutation is computed.
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  const std::vector<uint32_t> permutation = GraphBisection(lists, numDocs).Order(numThreads);
+
+  std::cout << "Permutation computed in " << std::fixed << std::setprecision(1)
+    << SecondsSince(start) << " s" << std::endl;
+
+  const std::string outputPath = GlobalState::dataDirectory + "/" + outputName;
+  std::ofstream outFile(outputPath, std::ios::out | std::ios::binary | std::ios::trunc);
+
+  if (outFile.fail()) {
+    throw std::runtime_error("Failed to open '" + outputPath + "'");
+  }
+
+  file.Open(Gov2SortedPath());
+  while (file.LoadNextSet(data)) {
+    RemapList(permutation, data);
+    writeList(outFile, data);
+  }
+  file.Close();
+
+  outFile.close();
+  if (outFile.fail()) {
+    throw std::runtime_error("Failed to write '" + outputPath + "'");
+  }
+
+  std::cout << "Reordered lists written to " << outputPath << std::endl << std::endl;
+
+  std::vector<const CodecDescriptor *> codecs(1, &VTEncCodecDescriptor());
+  for (const CodecDescriptor& desc : CodecTable()) {
+    if (desc.create()) {
+      codecs.push_back(&desc);
+    }
+  }
+
+  // The lists are measured before and after the reordering, which is applied
+  // to them in place, so that a single copy is kept in memory.
+  std::vector<CodecResult> before, after;
+
+  for (const CodecDescriptor *desc : codecs) {
+    before.push_back(measureCodec(*desc, lists, totalLength, maxLength));
+  }
+
+  for (std::vector<uint32_t>& list : lists) {
+    RemapList(permutation, list);
+  }
+
+  for (const CodecDescriptor *desc : codecs) {
+    after.push_back(measureCodec(*desc, lists, totalLength, maxLength));
+  }
+
+  std::cout << std::left << std::setw(28) << "Codec"
+    << std::right << std::setw(12) << "Bits/int" << std::setw(12) << "Reordered"
+    << std::setw(12) << "Decode M/s" << std::setw(12) << "Reordered" << std::endl;
+
+  for (size_t c = 0; c < codecs.size(); ++c) {
+    std::cout << std::left << std::setw(28) << codecs[c]->name << std::right << std::fixed
+      << std::setprecision(2) << std::setw(12) << before[c].bitsPerInt << std::setw(12) << after[c].bitsPerInt
+      << std::setprecision(0) << std::setw(12) << before[c].decodeSpeed << std::setw(12) << after[c].decodeSpeed
+      << std::endl;
+  }
+}
@@ -0,0 +1,19 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#ifndef INTCOMPBENCH_REORDER_H_
+#define INTCOMPBENCH_REORDER_H_
+
+#include <string>
+
+// Reassigns the document identifiers of the gov2 lists (Gov2SortedPath()) by
+// recursive graph bisection and writes the lists, in the same format and
+// order, to `outputName` in the data directory. The permutation is computed
+// on the lists with at least 4096 integers, with one thread per core. Then,
+// for VTEnc and every codec of the table, prints the size and the decoding
+// speed of those lists before and after the reordering. The file can be
+// benchmarked like the original one with --gov2-file.
+void ReorderGov2(const std::string& outputName);
+
+#endif // INTCOMPBENCH_REORDER_H_
@@ -0,0 +1,97 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#include "smalllist.h"
+
+#include <stdexcept>
+#include <string>
+
+static uint32_t bitWidth(uint32_t value) {
+  return (value == 0) ? 0 : 32 - __builtin_clz(value);
+}
+
+void DeltaBitPacking::encodeArray(uint32_t *in, const size_t length, uint32_t *out, size_t &nvalue) {
+  if (length > MaxLength) {
+    throw std::logic_error("list too long for DeltaBitPacking");
+  }
+
+  if (length == 0) {
+    out[0] = 0;
+    nvalue = 1;
+    return;
+  }
+
+  uint32_t maxGap = 0;
+
+  for (size_t i = 1; i < length; ++i) {
+    maxGap |= in[i] - in[i - 1];
+  }
+
+  const uint32_t bits = bitWidth(maxGap);
+
+  out[0] = (static_cast<uint32_t>(length) << 6) | bits;
+  out[1] = in[0];
+
+  uint32_t *packed = out + 2;
+  uint64_t buffer = 0;
+  uint32_t bufferBits = 0;
+
+  for (size_t i = 1; i < length; ++i) {
+    buffer |= static_cast<uint64_t>(in[i] - in[i - 1]) << bufferBits;
+    bufferBits += bits;
+
+    if (bufferBits >= 32) {
+      *packed++ = static_cast<uint32_t>(buffer);
+      buffer >>= 32;
+      bufferBits -= 32;
+    }
+  }
+
+  if (bufferBits > 0) {
+    *packed++ = static_cast<uint32_t>(buffer);
+  }
+
+  nvalue = packed - out;
+}
+
+const uint32_t *DeltaBitPacking::decodeArray(const uint32_t *in, const size_t length, uint32_t *out, size_t &nvalue) {
+  const size_t count = in[0] >> 6;
+  const uint32_t bits = in[0] & 63;
+
+  if (count > nvalue) {
+    throw std::logic_error("output buffer too small for DeltaBitPacking");
+  }
+
+  nvalue = count;
+
+  if (count == 0) {
+    return in + 1;
+  }
+
+  const uint32_t *packed = in + 2;
+  const uint64_t mask = (uint64_t(1) << bits) - 1;
+  uint64_t buffer = 0;
+  uint32_t bufferBits = 0;
+  uint32_t value = in[1];
+
+  out[0] = value;
+
+  for (size_t i = 1; i < count; ++i) {
+    if (bufferBits < bits) {
+      buffer |= static_cast<uint64_t>(*packed++) << bufferBits;
+      bufferBits += 32;
+    }
+
+    value += static_cast<uint32_t>(buffer & mask);
+    buffer >>= bits;
+    bufferBits -= bits;
+    out[i] = value;
+  }
+
+  return packed;
+}
+
+std::string DeltaBitPacking::name() const {
+  return std::string("DeltaBitPacking");
+}
@@ -0,0 +1,25 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#ifndef INTCOMPBENCH_SMALLLIST_H_
+#define INTCOMPBENCH_SMALLLIST_H_
+
+#include <string>
+
+#include "SIMDCompressionAndIntersection/include/codecs.h"
+
+// Codec for short sorted lists and for the tails that block codecs leave
+// behind. The list is encoded as a frame of reference without exceptions:
+// a header word with the length and the bit width, the first value, and the
+// gaps between consecutive values bit-packed with a single bit width.
+class DeltaBitPacking : public SIMDCompressionLib::IntegerCODEC {
+public:
+  static const size_t MaxLength = (size_t(1) << 26) - 1;
+
+  void encodeArray(uint32_t *in, const size_t length, uint32_t *out, size_t &nvalue);
+  const uint32_t *decodeArray(const uint32_t *in, const size_t length, uint32_t *out, size_t &nvalue);
+  std::string name() const;
+};
+
+#endif // INTCOMPBENCH_SMALLLIST_H_
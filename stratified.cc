@@ -0,0 +1,214 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#include "stratified.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Gaps shorter than this are read through the stream buffer instead of
+// seeking over them.
+static const uint64_t maxIgnoredBytes = 1 << 16;
+
+// 95% quantile of the normal distribution.
+static const double z95 = 1.959964;
+
+static void skipBytes(std::ifstream& inFile, uint64_t bytes) {
+  if (bytes < maxIgnoredBytes) {
+    inFile.ignore(static_cast<std::streamsize>(bytes));
+  } else {
+    inFile.seekg(static_cast<std::streamoff>(bytes), std::ios::cur);
+  }
+}
+
+static bool readUint32(std::ifstream& inFile, uint32_t& value) {
+  return static_cast<bool>(inFile.read(reinterpret_cast<char *>(&value), sizeof(value)));
+}
+
+static size_t stratumOf(uint32_t length, uint32_t first, uint32_t last) {
+  size_t lengthClass = 0;
+  size_t densityClass = 0;
+
+  for (uint64_t limit = 8; length >= limit && lengthClass + 1 < StratifiedSample::numLengthClasses; limit *= 8) {
+    lengthClass++;
+  }
+
+  if (length > 0) {
+    const double density = double(length) / (double(last) - double(first) + 1.0);
+
+    for (double limit = 0.5; density < limit && densityClass + 1 < StratifiedSample::numDensityClasses; limit /= 8) {
+      densityClass++;
+    }
+  }
+
+  return lengthClass * StratifiedSample::numDensityClasses + densityClass;
+}
+
+StratifiedSample::StratifiedSample(): _numLists(0), _numIntegers(0) {
+}
+
+void StratifiedSample::Build(const std::string& fileName, double fraction, uint64_t seed) {
+  if (!(fraction > 0.0 && fraction <= 1.0)) {
+    throw std::logic_error("the sample fraction must be in (0, 1]");
+  }
+
+  std::ifstream inFile(fileName, std::ios::in | std::ios::binary);
+  std::vector<uint8_t> listStrata;
+  uint32_t length;
+
+  if (inFile.fail()) {
+    throw std::logic_error("Failed to open '" + fileName + "'");
+  }
+
+  _strata.assign(numLengthClasses * numDensityClasses, Stratum());
+  _lists.clear();
+  _numLists = 0;
+  _numIntegers = 0;
+
+  // First pass: the stratum of every list.
+  while (readUint32(inFile, length)) {
+    uint32_t first = 0, last = 0;
+
+    if (length > 0) {
+      readUint32(inFile, first);
+      last = first;
+    }
+    if (length > 1) {
+      skipBytes(inFile, uint64_t(length - 2) * sizeof(uint32_t));
+      readUint32(inFile, last);
+    }
+
+    if (!inFile) {
+      throw std::runtime_error("'" + fileName + "' is truncated");
+    }
+
+    const size_t s = stratumOf(length, first, last);
+
+    listStrata.push_back(static_cast<uint8_t>(s));
+    _strata[s].numLists++;
+    _strata[s].numIntegers += length;
+    _numLists++;
+    _numIntegers += length;
+  }
+
+  // Second pass: sequential selection of the lists of every stratum, so that
+  // each one gets exactly its share.
+  std::vector<uint64_t> wanted(_strata.size()), seen(_strata.size(), 0);
+  std::mt19937_64 generator(seed);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+  for (size_t s = 0; s < _strata.size(); ++s) {
+    const uint64_t numLists = _strata[s].numLists;
+    wanted[s] = std::min(numLists, std::max(uint64_t(2), uint64_t(std::llround(fraction * numLists))));
+  }
+
+  inFile.clear();
+  inFile.seekg(0, std::ios::beg);
+
+  for (size_t l = 0; l < listStrata.size(); ++l) {
+    const size_t s = listStrata[l];
+    Stratum& stratum = _strata[s];
+    const uint64_t remaining = stratum.numLists - seen[s];
+    const bool selected = uniform(generator) * remaining < wanted[s] - stratum.sampled.size();
+
+    readUint32(inFile, length);
+    seen[s]++;
+
+    if (selected) {
+      _lists.push_back(std::vector<uint32_t>(length));
+      inFile.read(reinterpret_cast<char *>(_lists.back().data()), std::streamsize(length) * sizeof(uint32_t));
+      stratum.sampled.push_back(_lists.size() - 1);
+    } else {
+      skipBytes(inFile, uint64_t(length) * sizeof(uint32_t));
+    }
+
+    if (!inFile) {
+      throw std::runtime_error("'" + fileName + "' is truncated");
+    }
+  }
+}
+
+bool StratifiedSample::Empty() const {
+  return _lists.empty();
+}
+
+std::vector<std::vector<uint32_t> >& StratifiedSample::Lists() {
+  return _lists;
+}
+
+const std::vector<std::vector<uint32_t> >& StratifiedSample::Lists() const {
+  return _lists;
+}
+
+const std::vector<StratifiedSample::Stratum>& StratifiedSample::Strata() const {
+  return _strata;
+}
+
+uint64_t StratifiedSample::NumLists() const {
+  return _numLists;
+}
+
+uint64_t StratifiedSample::NumIntegers() const {
+  return _numIntegers;
+}
+
+uint64_t StratifiedSample::SampledIntegers() const {
+  uint64_t integers = 0;
+
+  for (const std::vector<uint32_t>& list : _lists) {
+    integers += list.size();
+  }
+
+  return integers;
+}
+
+Estimate StratifiedSample::EstimateTotal(const std::vector<double>& values) const {
+  Estimate estimate = {0.0, 0.0};
+  double variance = 0.0;
+
+  if (values.size() != _lists.size()) {
+    throw std::logic_error("one value per sampled list is needed");
+  }
+
+  for (const Stratum& stratum : _strata) {
+    const size_t n = stratum.sampled.size();
+    double sumValues = 0.0, sumLengths = 0.0;
+
+    if (n == 0) {
+      continue;
+    }
+
+    for (size_t i : stratum.sampled) {
+      sumValues += values[i];
+      sumLengths += _lists[i].size();
+    }
+
+    // Strata of empty lists have nothing to be proportional to.
+    const double ratio = (sumLengths > 0) ? sumValues / sumLengths : 0.0;
+    const double total = (sumLengths > 0) ? ratio * stratum.numIntegers : sumValues / n * stratum.numLists;
+
+    estimate.total += total;
+
+    if (n < 2 || n == stratum.numLists) {
+      continue;
+    }
+
+    double sumSquares = 0.0;
+    for (size_t i : stratum.sampled) {
+      const double residual = (sumLengths > 0) ? values[i] - ratio * _lists[i].size() : values[i] - sumValues / n;
+      sumSquares += residual * residual;
+    }
+
+    const double N = double(stratum.numLists);
+    variance += N * N * (1.0 - n / N) * (sumSquares / (n - 1)) / n;
+  }
+
+  estimate.halfWidth = z95 * std::sqrt(variance);
+  return estimate;
+}
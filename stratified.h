@@ -0,0 +1,67 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#ifndef INTCOMPBENCH_STRATIFIED_H_
+#define INTCOMPBENCH_STRATIFIED_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Estimate of a total over the whole corpus and the half width of its 95%
+// confidence interval.
+struct Estimate {
+  double total;
+  double halfWidth;
+
+  double Low() const { return total - halfWidth; }
+  double High() const { return total + halfWidth; }
+};
+
+// Stratified random sample of the lists of a gov2.sorted-like file. The lists
+// are split in strata by length (powers of 8, from 1 to 2^18 and more) and by
+// density, the length divided by the range of values (limits 1/2, 1/16,
+// 1/128 and 1/1024, the last class being less than 1/1024). Every stratum
+// contributes `fraction` of its lists, and at least two, picked at random.
+// The file is read twice: once for the length and the first and last values
+// of every list, and once for the lists in the sample.
+class StratifiedSample {
+public:
+  struct Stratum {
+    uint64_t numLists;
+    uint64_t numIntegers;
+    // Positions in Lists() of the lists sampled from this stratum.
+    std::vector<size_t> sampled;
+  };
+
+private:
+  std::vector<Stratum> _strata;
+  std::vector<std::vector<uint32_t> > _lists;
+  uint64_t _numLists;
+  uint64_t _numIntegers;
+
+public:
+  static const size_t numLengthClasses = 7;
+  static const size_t numDensityClasses = 5;
+
+  StratifiedSample();
+
+  void Build(const std::string& fileName, double fraction, uint64_t seed);
+  bool Empty() const;
+  std::vector<std::vector<uint32_t> >& Lists();
+  const std::vector<std::vector<uint32_t> >& Lists() const;
+  const std::vector<Stratum>& Strata() const;
+  uint64_t NumLists() const;
+  uint64_t NumIntegers() const;
+  uint64_t SampledIntegers() const;
+
+  // Estimates the total over the corpus of a measure of the lists, given its
+  // value for every list of the sample, in the order of Lists(). Within every
+  // stratum, the measure is taken to be proportional to the length of the
+  // lists (separate ratio estimator), which suits sizes and times.
+  Estimate EstimateTotal(const std::vector<double>& values) const;
+};
+
+#endif // INTCOMPBENCH_STRATIFIED_H_
@@ -0,0 +1,76 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#include "streaming.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "common.h"
+
+StreamingEncoder::StreamingEncoder(
+  SIMDCompressionLib::IntegerCODEC& codec,
+  size_t codecBlockSize,
+  size_t blockLength): _codec(codec), _codecBlockSize(codecBlockSize), _blockLength(blockLength), _sealedLength(0)
+{
+  _open.reserve(blockLength);
+  _buffer.resize(blockLength + 1024);
+}
+
+void StreamingEncoder::Seal() {
+  if (_open.empty()) {
+    return;
+  }
+
+  size_t encodedLength = EncodeWithFallback(_codec, _fallbackCodec, _codecBlockSize,
+    _open.data(), _open.size(), _buffer.data(), _buffer.size());
+
+  _blockOffsets.push_back(_sealed.size());
+  _blockLengths.push_back(_open.size());
+  _sealedLength += _open.size();
+  _sealed.insert(_sealed.end(), _buffer.begin(), _buffer.begin() + encodedLength);
+  _open.clear();
+}
+
+size_t StreamingEncoder::Size() {
+  return _sealedLength + _open.size();
+}
+
+size_t StreamingEncoder::NumSealedBlocks() {
+  return _blockOffsets.size();
+}
+
+size_t StreamingEncoder::OpenBlockLength() {
+  return _open.size();
+}
+
+size_t StreamingEncoder::ReadSealedBlock(size_t block, uint32_t *out) {
+  size_t end = (block + 1 < _blockOffsets.size()) ? _blockOffsets[block + 1] : _sealed.size();
+
+  DecodeWithFallback(_codec, _fallbackCodec, _codecBlockSize,
+    _sealed.data() + _blockOffsets[block], end - _blockOffsets[block], out, _blockLengths[block]);
+
+  return _blockLengths[block];
+}
+
+size_t StreamingEncoder::ReadOpenBlock(uint32_t *out) {
+  std::copy(_open.begin(), _open.end(), out);
+  return _open.size();
+}
+
+size_t StreamingEncoder::ReadAll(uint32_t *out) {
+  size_t count = 0;
+
+  for (size_t block = 0; block < _blockOffsets.size(); ++block) {
+    count += ReadSealedBlock(block, out + count);
+  }
+
+  return count + ReadOpenBlock(out + count);
+}
+
+// The open block is counted uncompressed, and every sealed block adds a
+// 32-bit offset and a 32-bit length to the directory.
+size_t StreamingEncoder::EncodedLengthInBytes() {
+  return (_sealed.size() + _open.size() + 2 * _blockOffsets.size()) * sizeof(uint32_t);
+}
@@ -0,0 +1,52 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#ifndef INTCOMPBENCH_STREAMING_H_
+#define INTCOMPBENCH_STREAMING_H_
+
+#include <vector>
+
+#include "SIMDCompressionAndIntersection/include/codecs.h"
+#include "SIMDCompressionAndIntersection/include/variablebyte.h"
+
+// Append-only encoder for sorted integers that arrive one at a time. Values
+// are buffered in an open block; when it holds `blockLength` values it is
+// sealed, that is, encoded with the codec (the integers that do not fill a
+// whole codec block go to VByte<true>) and appended to the sealed blocks.
+// Both the sealed blocks and the open block can be read at any time.
+class StreamingEncoder {
+private:
+  SIMDCompressionLib::VByte<true> _fallbackCodec;
+  SIMDCompressionLib::IntegerCODEC& _codec;
+  size_t _codecBlockSize;
+  size_t _blockLength;
+  std::vector<uint32_t> _open;
+  std::vector<uint32_t> _sealed;
+  std::vector<size_t> _blockOffsets;
+  std::vector<size_t> _blockLengths;
+  size_t _sealedLength;
+  std::vector<uint32_t> _buffer;
+
+public:
+  StreamingEncoder(SIMDCompressionLib::IntegerCODEC& codec, size_t codecBlockSize, size_t blockLength);
+
+  void Append(uint32_t value) {
+    _open.push_back(value);
+    if (_open.size() == _blockLength) {
+      Seal();
+    }
+  }
+
+  void Seal();
+
+  size_t Size();
+  size_t NumSealedBlocks();
+  size_t OpenBlockLength();
+  size_t ReadSealedBlock(size_t block, uint32_t *out);
+  size_t ReadOpenBlock(uint32_t *out);
+  size_t ReadAll(uint32_t *out);
+  size_t EncodedLengthInBytes();
+};
+
+#endif // INTCOMPBENCH_STREAMING_H_
@@ -0,0 +1,354 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#include "timeseries.h"
+
+#include <emmintrin.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+static const size_t blockLength = 128;
+
+static uint32_t bitWidth(uint32_t value) {
+  return (value == 0) ? 0 : 32 - __builtin_clz(value);
+}
+
+static size_t numBlocks(size_t length) {
+  return (length + blockLength - 1) / blockLength;
+}
+
+// Words taken by the bit widths, one byte per block.
+static size_t widthWords(size_t length) {
+  return (numBlocks(length) + 3) / 4;
+}
+
+// Packs a block with `bits` bits per integer. Integer i goes to lane i % 4,
+// and the words of the four lanes are interleaved, so every lane takes exactly
+// `bits` words.
+static void packBlock(const uint32_t *in, uint32_t bits, uint32_t *out) {
+  if (bits == 0) {
+    return;
+  }
+
+  for (size_t lane = 0; lane < 4; ++lane) {
+    uint32_t *word = out + lane;
+    uint64_t buffer = 0;
+    uint32_t bufferBits = 0;
+
+    for (size_t i = lane; i < blockLength; i += 4) {
+      buffer |= static_cast<uint64_t>(in[i]) << bufferBits;
+      bufferBits += bits;
+
+      if (bufferBits >= 32) {
+        *word = static_cast<uint32_t>(buffer);
+        word += 4;
+        buffer >>= 32;
+        bufferBits -= 32;
+      }
+    }
+  }
+}
+
+// Unpacks a block written by packBlock. out[i] receives integers 4i to 4i+3.
+static void unpackBlock(const uint32_t *in, uint32_t bits, __m128i *out) {
+  if (bits == 0) {
+    for (size_t i = 0; i < blockLength / 4; ++i) {
+      _mm_storeu_si128(out + i, _mm_setzero_si128());
+    }
+    return;
+  }
+
+  const __m128i *words = reinterpret_cast<const __m128i *>(in);
+  const __m128i mask = _mm_set1_epi32((bits == 32) ? -1 : static_cast<int>((1u << bits) - 1));
+  __m128i word = _mm_loadu_si128(words++);
+  uint32_t shift = 0;
+
+  for (size_t i = 0; i < blockLength / 4; ++i) {
+    __m128i value = _mm_srl_epi32(word, _mm_cvtsi32_si128(shift));
+
+    if (shift + bits > 32) {
+      word = _mm_loadu_si128(words++);
+      value = _mm_or_si128(value, _mm_sll_epi32(word, _mm_cvtsi32_si128(32 - shift)));
+      shift = shift + bits - 32;
+    } else if (shift + bits == 32) {
+      shift = 0;
+      if (i + 1 < blockLength / 4) {
+        word = _mm_loadu_si128(words++);
+      }
+    } else {
+      shift += bits;
+    }
+
+    _mm_storeu_si128(out + i, _mm_and_si128(value, mask));
+  }
+}
+
+// Writes the bit widths of the blocks and then the blocks, the last one padded
+// with zeros. Returns the number of words written.
+static size_t packArray(const uint32_t *in, size_t length, uint32_t *out, size_t capacity, const std::string& codecName) {
+  const size_t blocks = numBlocks(length);
+  size_t total = widthWords(length);
+
+  if (total > capacity) {
+    throw std::logic_error("output buffer too small for " + codecName);
+  }
+
+  std::memset(out, 0, total * sizeof(uint32_t));
+  uint8_t *widths = reinterpret_cast<uint8_t *>(out);
+
+  for (size_t b = 0; b < blocks; ++b) {
+    const size_t end = std::min(length, (b + 1) * blockLength);
+    uint32_t acc = 0;
+
+    for (size_t i = b * blockLength; i < end; ++i) {
+      acc |= in[i];
+    }
+
+    widths[b] = static_cast<uint8_t>(bitWidth(acc));
+    total += 4 * widths[b];
+  }
+
+  if (total > capacity) {
+    throw std::logic_error("output buffer too small for " + codecName);
+  }
+
+  uint32_t *block = out + widthWords(length);
+  uint32_t padded[blockLength];
+
+  for (size_t b = 0; b < blocks; ++b) {
+    const uint32_t *values = in + b * blockLength;
+    const size_t count = std::min(length - b * blockLength, blockLength);
+
+    if (count < blockLength) {
+      std::fill(std::copy(values, values + count, padded), padded + blockLength, 0);
+      values = padded;
+    }
+
+    packBlock(values, widths[b], block);
+    block += 4 * widths[b];
+  }
+
+  return total;
+}
+
+// Unpacks `length` integers written by packArray. Returns the end of the
+// packed array.
+static const uint32_t *unpackArray(const uint32_t *in, size_t length, uint32_t *out) {
+  const size_t blocks = numBlocks(length);
+  const uint8_t *widths = reinterpret_cast<const uint8_t *>(in);
+  const uint32_t *block = in + widthWords(length);
+  __m128i padded[blockLength / 4];
+
+  for (size_t b = 0; b < blocks; ++b) {
+    const size_t count = std::min(length - b * blockLength, blockLength);
+
+    if (count == blockLength) {
+      unpackBlock(block, widths[b], reinterpret_cast<__m128i *>(out + b * blockLength));
+    } else {
+      unpackBlock(block, widths[b], padded);
+      std::memcpy(out + b * blockLength, padded, count * sizeof(uint32_t));
+    }
+
+    block += 4 * widths[b];
+  }
+
+  return block;
+}
+
+static inline __m128i prefixSum(__m128i x, __m128i carry) {
+  x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+  x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+  return _mm_add_epi32(x, carry);
+}
+
+static inline __m128i lastLane(__m128i x) {
+  return _mm_shuffle_epi32(x, 0xFF);
+}
+
+void DeltaOfDelta::encodeArray(uint32_t *in, const size_t length, uint32_t *out, size_t &nvalue) {
+  if (nvalue < 2) {
+    throw std::logic_error("output buffer too small for " + name());
+  }
+
+  out[0] = static_cast<uint32_t>(length);
+
+  if (length == 0) {
+    nvalue = 1;
+    return;
+  }
+
+  out[1] = in[0];
+
+  // The zigzag-encoded deltas of delta are written in place of the input.
+  uint32_t previous = in[0];
+  uint32_t previousGap = 0;
+
+  for (size_t i = 1; i < length; ++i) {
+    const uint32_t gap = in[i] - previous;
+    const int32_t dod = static_cast<int32_t>(gap - previousGap);
+    previous = in[i];
+    previousGap = gap;
+    in[i - 1] = (static_cast<uint32_t>(dod) << 1) ^ static_cast<uint32_t>(dod >> 31);
+  }
+
+  nvalue = 2 + packArray(in, length - 1, out + 2, nvalue - 2, name());
+}
+
+const uint32_t *DeltaOfDelta::decodeArray(const uint32_t *in, const size_t length, uint32_t *out, size_t &nvalue) {
+  const size_t count = in[0];
+
+  if (count > nvalue) {
+    throw std::logic_error("output buffer too small for " + name());
+  }
+
+  nvalue = count;
+
+  if (count == 0) {
+    return in + 1;
+  }
+
+  const size_t numDeltas = count - 1;
+  const uint8_t *widths = reinterpret_cast<const uint8_t *>(in + 2);
+  const uint32_t *block = in + 2 + widthWords(numDeltas);
+  const __m128i one = _mm_set1_epi32(1);
+  __m128i previous = _mm_set1_epi32(in[1]);
+  __m128i previousGap = _mm_setzero_si128();
+  __m128i values[blockLength / 4];
+  uint32_t *output = out + 1;
+
+  out[0] = in[1];
+
+  for (size_t b = 0; b < numBlocks(numDeltas); ++b) {
+    const size_t blockCount = std::min(numDeltas - b * blockLength, blockLength);
+
+    unpackBlock(block, widths[b], values);
+    block += 4 * widths[b];
+
+    for (size_t i = 0; i * 4 < blockCount; ++i) {
+      const __m128i zigzag = values[i];
+      const __m128i dod = _mm_xor_si128(_mm_srli_epi32(zigzag, 1),
+        _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(zigzag, one)));
+      const __m128i gaps = prefixSum(dod, previousGap);
+      const __m128i decoded = prefixSum(gaps, previous);
+
+      previousGap = lastLane(gaps);
+      previous = lastLane(decoded);
+
+      if (blockCount - i * 4 >= 4) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(output), decoded);
+        output += 4;
+      } else {
+        uint32_t last[4];
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(last), decoded);
+        output = std::copy(last, last + (blockCount - i * 4), output);
+      }
+    }
+  }
+
+  return block;
+}
+
+std::string DeltaOfDelta::name() const {
+  return std::string("DeltaOfDelta");
+}
+
+void DeltaRunLength::encodeArray(uint32_t *in, const size_t length, uint32_t *out, size_t &nvalue) {
+  if (nvalue < 2) {
+    throw std::logic_error("output buffer too small for " + name());
+  }
+
+  out[0] = static_cast<uint32_t>(length);
+
+  if (length == 0) {
+    nvalue = 1;
+    return;
+  }
+
+  out[1] = in[0];
+  _runGaps.clear();
+  _runLengths.clear();
+
+  uint32_t previous = in[0];
+
+  for (size_t i = 1; i < length; ++i) {
+    const uint32_t gap = in[i] - previous;
+    previous = in[i];
+
+    if (!_runGaps.empty() && _runGaps.back() == gap) {
+      ++_runLengths.back();
+    } else {
+      _runGaps.push_back(gap);
+      _runLengths.push_back(1);
+    }
+  }
+
+  const size_t numRuns = _runGaps.size();
+
+  if (nvalue < 3) {
+    throw std::logic_error("output buffer too small for " + name());
+  }
+
+  out[2] = static_cast<uint32_t>(numRuns);
+
+  size_t encodedLength = 3;
+  encodedLength += packArray(_runGaps.data(), numRuns, out + encodedLength, nvalue - encodedLength, name());
+  encodedLength += packArray(_runLengths.data(), numRuns, out + encodedLength, nvalue - encodedLength, name());
+  nvalue = encodedLength;
+}
+
+const uint32_t *DeltaRunLength::decodeArray(const uint32_t *in, const size_t length, uint32_t *out, size_t &nvalue) {
+  const size_t count = in[0];
+
+  if (count > nvalue) {
+    throw std::logic_error("output buffer too small for " + name());
+  }
+
+  nvalue = count;
+
+  if (count == 0) {
+    return in + 1;
+  }
+
+  const size_t numRuns = in[2];
+  uint32_t value = in[1];
+
+  _runGaps.resize(numRuns);
+  _runLengths.resize(numRuns);
+
+  const uint32_t *end = unpackArray(in + 3, numRuns, _runGaps.data());
+  end = unpackArray(end, numRuns, _runLengths.data());
+
+  *out++ = value;
+
+  for (size_t r = 0; r < numRuns; ++r) {
+    const uint32_t gap = _runGaps[r];
+    const size_t runLength = _runLengths[r];
+    const __m128i step = _mm_set1_epi32(static_cast<int>(gap * 4));
+    __m128i values = _mm_set_epi32(value + gap * 4, value + gap * 3, value + gap * 2, value + gap);
+    size_t i = 0;
+
+    for (; i + 4 <= runLength; i += 4) {
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), values);
+      values = _mm_add_epi32(values, step);
+    }
+
+    value += gap * static_cast<uint32_t>(i);
+
+    for (; i < runLength; ++i) {
+      value += gap;
+      out[i] = value;
+    }
+
+    out += runLength;
+  }
+
+  return end;
+}
+
+std::string DeltaRunLength::name() const {
+  return std::string("DeltaRunLength");
+}
@@ -0,0 +1,46 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#ifndef INTCOMPBENCH_TIMESERIES_H_
+#define INTCOMPBENCH_TIMESERIES_H_
+
+#include <string>
+#include <vector>
+
+#include "SIMDCompressionAndIntersection/include/codecs.h"
+
+// Codecs for regular series such as timestamps, where consecutive gaps are
+// equal or nearly so. Both store their integers in blocks of 128, each one
+// bit-packed with its own bit width in four interleaved 32-bit lanes, so that
+// they can be unpacked with SSE. The last block is padded with zeros. The bit
+// widths are kept apart, one byte per block.
+
+// Delta of delta, as in Gorilla: the first value is stored as is, and then
+// the difference between each gap and the previous gap (the first gap is
+// compared with 0), zigzag encoded. Unlike Gorilla, which spends a variable
+// length code on every value, the bit width is chosen per block, so a block
+// of equal gaps costs only its width byte.
+class DeltaOfDelta : public SIMDCompressionLib::IntegerCODEC {
+public:
+  void encodeArray(uint32_t *in, const size_t length, uint32_t *out, size_t &nvalue);
+  const uint32_t *decodeArray(const uint32_t *in, const size_t length, uint32_t *out, size_t &nvalue);
+  std::string name() const;
+};
+
+// Run-length encoding of the gaps: after the first value, every run of equal
+// gaps is stored as the gap and the length of the run, in two separate packed
+// arrays. Decoding expands each run as an arithmetic progression, four
+// integers at a time.
+class DeltaRunLength : public SIMDCompressionLib::IntegerCODEC {
+private:
+  std::vector<uint32_t> _runGaps;
+  std::vector<uint32_t> _runLengths;
+
+public:
+  void encodeArray(uint32_t *in, const size_t length, uint32_t *out, size_t &nvalue);
+  const uint32_t *decodeArray(const uint32_t *in, const size_t length, uint32_t *out, size_t &nvalue);
+  std::string name() const;
+};
+
+#endif // INTCOMPBENCH_TIMESERIES_H_
@@ -3,17 +3,21 @@
 // See LICENSE file in the project root for full license information.
 
 #include <algorithm>
+#include <chrono>
 #include <fstream>
+#include <limits>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "blockiterator.h"
+#include "colddecode.h"
 #include "common.h"
+#include "streaming.h"
+#include "vtenccodec.h"
 
 #include "benchmark/include/benchmark/benchmark.h"
-#include "SIMDCompressionAndIntersection/include/binarypacking.h"
-#include "SIMDCompressionAndIntersection/include/fastpfor.h"
-#include "SIMDCompressionAndIntersection/include/variablebyte.h"
-#include "SIMDCompressionAndIntersection/include/varintgb.h"
+#include "SIMDCompressionAndIntersection/include/codecs.h"
 #include "VTEnc/vtenc.h"
 
 class TimestampsDataSet : public benchmark::Fixture {
@@ -49,9 +53,9 @@ static void benchmarkEncode(SIMDCompressionUtil& comp, benchmark::State& state)
   CompressionStats stats(state);
 
   for (auto _ : state) {
-    state.PauseTiming();
+    stats.PauseTiming();
     comp.Reset();
-    state.ResumeTiming();
+    stats.ResumeTiming();
 
     comp.Encode();
   }
@@ -62,24 +66,24 @@ static void benchmarkEncode(SIMDCompressionUtil& comp, benchmark::State& state)
 }
 
 static void benchmarkDecode(SIMDCompressionUtil& comp, benchmark::State& state) {
-  CompressionStats stats(state);
-
   comp.Encode();
 
+  CompressionStats stats(state);
+
   for (auto _ : state) {
     comp.Decode();
   }
 
-  comp.EqualityCheck();
-
   stats.SetInputLengthInBytes(comp.InputLength() * sizeof(uint32_t));
   stats.SetEncodedLengthInBytes(comp.EncodedLength() * sizeof(uint32_t));
   stats.SetFinalStats();
+
+  comp.EqualityCheck();
 }
 
 BENCHMARK_F(TimestampsDataSet, Copy)(benchmark::State& state) {
-  CompressionStats stats(state);
   std::vector<uint32_t> copyTo(timestamps.size());
+  CompressionStats stats(state);
 
   for (auto _ : state)
     std::copy(timestamps.begin(), timestamps.end(), copyTo.begin());
@@ -90,14 +94,15 @@ BENCHMARK_F(TimestampsDataSet, Copy)(benchmark::State& state) {
 }
 
 BENCHMARK_F(TimestampsDataSet, VTEncEncode)(benchmark::State& state) {
-  CompressionStats stats(state);
-  std::vector<uint8_t> encoded(vtenc_max_encoded_size32(timestamps.size()));
+  HugePageVector<uint32_t> data(timestamps.begin(), timestamps.end());
+  HugePageVector<uint8_t> encoded(vtenc_max_encoded_size32(data.size()));
   vtenc *handler = vtenc_create();
+  CompressionStats stats(state);
 
   for (auto _ : state)
-    vtenc_encode32(handler, timestamps.data(), timestamps.size(), encoded.data(), encoded.size());
+    vtenc_encode32(handler, data.data(), data.size(), encoded.data(), encoded.size());
 
-  stats.SetInputLengthInBytes(timestamps.size() * sizeof(uint32_t));
+  stats.SetInputLengthInBytes(data.size() * sizeof(uint32_t));
   stats.SetEncodedLengthInBytes(vtenc_encoded_size(handler));
   stats.SetFinalStats();
 
@@ -105,85 +110,249 @@ BENCHMARK_F(TimestampsDataSet, VTEncEncode)(benchmark::State& state) {
 }
 
 BENCHMARK_F(TimestampsDataSet, VTEncDecode)(benchmark::State& state) {
-  CompressionStats stats(state);
-  std::vector<uint8_t> encoded(vtenc_max_encoded_size32(timestamps.size()));
+  HugePageVector<uint32_t> data(timestamps.begin(), timestamps.end());
+  HugePageVector<uint8_t> encoded(vtenc_max_encoded_size32(data.size()));
   vtenc *handler = vtenc_create();
   
-  vtenc_encode32(handler, timestamps.data(), timestamps.size(), encoded.data(), encoded.size());
+  vtenc_encode32(handler, data.data(), data.size(), encoded.data(), encoded.size());
   size_t encodedLength = vtenc_encoded_size(handler);
 
-  std::vector<uint32_t> decoded(timestamps.size());
+  HugePageVector<uint32_t> decoded(data.size());
+  CompressionStats stats(state);
 
   for (auto _ : state)
     vtenc_decode32(handler, encoded.data(), encodedLength, decoded.data(), decoded.size());
 
-  if (timestamps != decoded) {
-    throw std::logic_error("equality check failed");
-  }
-
-  stats.SetInputLengthInBytes(timestamps.size() * sizeof(uint32_t));
+  stats.SetInputLengthInBytes(data.size() * sizeof(uint32_t));
   stats.SetEncodedLengthInBytes(encodedLength);
   stats.SetFinalStats();
 
+  if (data != decoded) {
+    throw std::logic_error("equality check failed");
+  }
+
   vtenc_destroy(handler);
 }
 
-BENCHMARK_F(TimestampsDataSet, DeltaVariableByteEncode)(benchmark::State& state) {
-  SIMDCompressionLib::VByte<true> codec;
-  SIMDCompressionUtil comp(codec, 1, timestamps);
+static void benchmarkCodecEncode(TimestampsDataSet* obj, const CodecDescriptor& desc, benchmark::State& state) {
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = desc.create();
+  if (!codec) {
+    state.SkipWithError("codec not available");
+    return;
+  }
+  SIMDCompressionUtil comp(*codec, desc.blockSize, TimestampsDataSet::timestamps);
   benchmarkEncode(comp, state);
 }
 
-BENCHMARK_F(TimestampsDataSet, DeltaVariableByteDecode)(benchmark::State& state) {
-  SIMDCompressionLib::VByte<true> codec;
-  SIMDCompressionUtil comp(codec, 1, timestamps);
+static void benchmarkCodecDecode(TimestampsDataSet* obj, const CodecDescriptor& desc, benchmark::State& state) {
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = desc.create();
+  if (!codec) {
+    state.SkipWithError("codec not available");
+    return;
+  }
+  SIMDCompressionUtil comp(*codec, desc.blockSize, TimestampsDataSet::timestamps);
   benchmarkDecode(comp, state);
 }
 
-BENCHMARK_F(TimestampsDataSet, DeltaVarIntGBEncode)(benchmark::State& state) {
-  SIMDCompressionLib::VarIntGB<true> codec;
-  SIMDCompressionUtil comp(codec, 1, timestamps);
-  benchmarkEncode(comp, state);
+// state.range(0) is the CacheLevel the working set fits in.
+static void benchmarkCodecDecodeCold(TimestampsDataSet* obj, const CodecDescriptor& desc, benchmark::State& state) {
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = desc.create();
+  if (!codec) {
+    state.SkipWithError("codec not available");
+    return;
+  }
+  BenchmarkRotatingDecode(*codec, desc.blockSize, TimestampsDataSet::timestamps, CacheLevel(state.range(0)), state);
 }
 
-BENCHMARK_F(TimestampsDataSet, DeltaVarIntGBDecode)(benchmark::State& state) {
-  SIMDCompressionLib::VarIntGB<true> codec;
-  SIMDCompressionUtil comp(codec, 1, timestamps);
-  benchmarkDecode(comp, state);
+// state.range(0) is the FusedConsumer.
+static void benchmarkCodecScanFull(TimestampsDataSet* obj, const CodecDescriptor& desc, benchmark::State& state) {
+  std::vector<std::vector<uint32_t> > lists(1, TimestampsDataSet::timestamps);
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = desc.create();
+  if (!codec) {
+    state.SkipWithError("codec not available");
+    return;
+  }
+  BenchmarkFusedScan(*codec, desc.blockSize, lists, FusedConsumer(state.range(0)), 0, state);
 }
 
-BENCHMARK_F(TimestampsDataSet, DeltaBinaryPackingEncode)(benchmark::State& state) {
-  SIMDCompressionLib::BinaryPacking<SIMDCompressionLib::BasicBlockPacker> codec;
-  SIMDCompressionUtil comp(codec, codec.BlockSize, timestamps);
-  benchmarkEncode(comp, state);
+// state.range(0) is the FusedConsumer and state.range(1) the block length.
+static void benchmarkCodecScanBlocks(TimestampsDataSet* obj, const CodecDescriptor& desc, benchmark::State& state) {
+  std::vector<std::vector<uint32_t> > lists(1, TimestampsDataSet::timestamps);
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = desc.create();
+  if (!codec) {
+    state.SkipWithError("codec not available");
+    return;
+  }
+  BenchmarkFusedScan(*codec, desc.blockSize, lists, FusedConsumer(state.range(0)), state.range(1), state);
 }
 
-BENCHMARK_F(TimestampsDataSet, DeltaBinaryPackingDecode)(benchmark::State& state) {
-  SIMDCompressionLib::BinaryPacking<SIMDCompressionLib::BasicBlockPacker> codec;
-  SIMDCompressionUtil comp(codec, codec.BlockSize, timestamps);
-  benchmarkDecode(comp, state);
+static uint64_t nanosecondsBetween(
+  std::chrono::steady_clock::time_point start,
+  std::chrono::steady_clock::time_point end)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
 }
 
-BENCHMARK_F(TimestampsDataSet, DeltaFastPFor128Encode)(benchmark::State& state) {
-  SIMDCompressionLib::FastPFor<4, true> codec;
-  SIMDCompressionUtil comp(codec, codec.BlockSize, timestamps);
-  benchmarkEncode(comp, state);
+static uint64_t clockOverhead() {
+  uint64_t overhead = std::numeric_limits<uint64_t>::max();
+
+  for (int i = 0; i < 1000; ++i) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    overhead = std::min(overhead, nanosecondsBetween(start, end));
+  }
+
+  return overhead;
 }
 
-BENCHMARK_F(TimestampsDataSet, DeltaFastPFor128Decode)(benchmark::State& state) {
-  SIMDCompressionLib::FastPFor<4, true> codec;
-  SIMDCompressionUtil comp(codec, codec.BlockSize, timestamps);
-  benchmarkDecode(comp, state);
+// Replays the timestamps as a stream, appending them one at a time to a
+// StreamingEncoder whose blocks hold state.range(0) values. The timed loop
+// gives the sustained ingest rate; a further replay times every append on its
+// own to get the latency percentiles, from which the cost of reading the
+// clock is subtracted.
+static void benchmarkStreamIngest(TimestampsDataSet* obj, const CodecDescriptor& desc, benchmark::State& state) {
+  std::vector<uint32_t>& timestamps = TimestampsDataSet::timestamps;
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = desc.create();
+  if (!codec) {
+    state.SkipWithError("codec not available");
+    return;
+  }
+  size_t blockLength = state.range(0);
+  std::unique_ptr<StreamingEncoder> timedEncoder;
+  CompressionStats stats(state);
+
+  for (auto _ : state) {
+    stats.PauseTiming();
+    timedEncoder.reset(new StreamingEncoder(*codec, desc.blockSize, blockLength));
+    stats.ResumeTiming();
+
+    for (uint32_t t : timestamps) {
+      timedEncoder->Append(t);
+    }
+  }
+
+  stats.SetInputLengthInBytes(timestamps.size() * sizeof(uint32_t));
+  stats.SetEncodedLengthInBytes(timedEncoder->EncodedLengthInBytes());
+  stats.SetFinalStats();
+
+  StreamingEncoder encoder(*codec, desc.blockSize, blockLength);
+  LatencyHistogram latencies;
+  uint64_t overhead = clockOverhead();
+
+  for (uint32_t t : timestamps) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    encoder.Append(t);
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    uint64_t elapsed = nanosecondsBetween(start, end);
+    latencies.Add((elapsed > overhead) ? (elapsed - overhead) : 0);
+  }
+
+  std::vector<uint32_t> decoded(encoder.Size());
+  encoder.ReadAll(decoded.data());
+  if (timestamps != decoded) {
+    throw std::logic_error("equality check failed");
+  }
+
+  state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(timestamps.size()));
+  state.counters["p50Ns"] = latencies.Percentile(50);
+  state.counters["p99Ns"] = latencies.Percentile(99);
+  state.counters["p999Ns"] = latencies.Percentile(99.9);
+  state.counters["maxNs"] = latencies.Max();
 }
 
-BENCHMARK_F(TimestampsDataSet, DeltaFastPFor256Encode)(benchmark::State& state) {
-  SIMDCompressionLib::FastPFor<8, true> codec;
-  SIMDCompressionUtil comp(codec, codec.BlockSize, timestamps);
-  benchmarkEncode(comp, state);
+// Reads back the whole stream, sealed blocks and open block, from an encoder
+// that has been fed with all the timestamps.
+static void benchmarkStreamRead(TimestampsDataSet* obj, const CodecDescriptor& desc, benchmark::State& state) {
+  std::vector<uint32_t>& timestamps = TimestampsDataSet::timestamps;
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = desc.create();
+  if (!codec) {
+    state.SkipWithError("codec not available");
+    return;
+  }
+  StreamingEncoder encoder(*codec, desc.blockSize, state.range(0));
+
+  for (uint32_t t : timestamps) {
+    encoder.Append(t);
+  }
+
+  std::vector<uint32_t> decoded(encoder.Size());
+  CompressionStats stats(state);
+
+  for (auto _ : state)
+    encoder.ReadAll(decoded.data());
+
+  stats.SetInputLengthInBytes(timestamps.size() * sizeof(uint32_t));
+  stats.SetEncodedLengthInBytes(encoder.EncodedLengthInBytes());
+  stats.SetFinalStats();
+
+  if (timestamps != decoded) {
+    throw std::logic_error("equality check failed");
+  }
 }
 
-BENCHMARK_F(TimestampsDataSet, DeltaFastPFor256Decode)(benchmark::State& state) {
-  SIMDCompressionLib::FastPFor<8, true> codec;
-  SIMDCompressionUtil comp(codec, codec.BlockSize, timestamps);
-  benchmarkDecode(comp, state);
+// VTEnc as the TimestampsDataSet/VTEnc* benchmarks use it, with its default of
+// allowing repeated values: most of the timestamps are repeated, which the
+// VTEnc codec of the table rejects.
+static CodecDescriptor makeVTEncTimestampsDescriptor() {
+  CodecDescriptor desc;
+  desc.name = "VTEnc";
+  desc.blockSize = 1;
+  desc.create = []() {
+    return std::shared_ptr<SIMDCompressionLib::IntegerCODEC>(new VTEncCodec(1, true));
+  };
+  return desc;
+}
+
+static const CodecDescriptor& vtencTimestampsDescriptor() {
+  static const CodecDescriptor desc = makeVTEncTimestampsDescriptor();
+  return desc;
+}
+
+static void registerStreamBenchmarks(const CodecDescriptor& codec) {
+  const std::string prefix = "TimestampsDataSet/" + codec.name;
+
+  benchmark::internal::RegisterBenchmarkInternal(
+    new CodecBenchmark<TimestampsDataSet>(prefix + "StreamIngest", codec, benchmarkStreamIngest))
+    ->RangeMultiplier(8)->Range(128, 1 << 16)->Iterations(1);
+
+  benchmark::internal::RegisterBenchmarkInternal(
+    new CodecBenchmark<TimestampsDataSet>(prefix + "StreamRead", codec, benchmarkStreamRead))
+    ->RangeMultiplier(8)->Range(128, 1 << 16);
+}
+
+static bool registerCodecBenchmarks() {
+  RegisterCodecBenchmarks<TimestampsDataSet>("TimestampsDataSet", "Encode", benchmarkCodecEncode);
+  RegisterCodecBenchmarks<TimestampsDataSet>("TimestampsDataSet", "Decode", benchmarkCodecDecode);
+
+  // The timestamps do not fit in any cache, so they are only decoded cold
+  // from DRAM.
+  for (auto b : RegisterCodecBenchmarks<TimestampsDataSet>("TimestampsDataSet", "DecodeCold", benchmarkCodecDecodeCold)) {
+    b->Arg(CACHE_DRAM);
+  }
+  benchmark::internal::RegisterBenchmarkInternal(
+    new CodecBenchmark<TimestampsDataSet>("TimestampsDataSet/VTEncDecodeCold", vtencTimestampsDescriptor(), benchmarkCodecDecodeCold))
+    ->Arg(CACHE_DRAM);
+
+  for (auto b : RegisterCodecBenchmarks<TimestampsDataSet>("TimestampsDataSet", "ScanFull", benchmarkCodecScanFull)) {
+    b->DenseRange(FUSED_SUM, FUSED_FILTER_BITMAP);
+  }
+  benchmark::internal::RegisterBenchmarkInternal(
+    new CodecBenchmark<TimestampsDataSet>("TimestampsDataSet/VTEncScanFull", vtencTimestampsDescriptor(), benchmarkCodecScanFull))
+    ->DenseRange(FUSED_SUM, FUSED_FILTER_BITMAP);
+
+  for (auto b : RegisterCodecBenchmarks<TimestampsDataSet>("TimestampsDataSet", "ScanBlocks", benchmarkCodecScanBlocks)) {
+    b->ArgsProduct({{FUSED_SUM, FUSED_COUNT_IN_RANGE, FUSED_FILTER_BITMAP}, {128, 256}});
+  }
+  benchmark::internal::RegisterBenchmarkInternal(
+    new CodecBenchmark<TimestampsDataSet>("TimestampsDataSet/VTEncScanBlocks", vtencTimestampsDescriptor(), benchmarkCodecScanBlocks))
+    ->ArgsProduct({{FUSED_SUM, FUSED_COUNT_IN_RANGE, FUSED_FILTER_BITMAP}, {128, 256}});
+
+  registerStreamBenchmarks(vtencTimestampsDescriptor());
+  for (const char *name : {"DeltaBinaryPacking", "DeltaFastPFor128", "DeltaFastPFor256"}) {
+    registerStreamBenchmarks(*FindCodec(name));
+  }
+
+  return true;
 }
+
+static bool codecBenchmarksRegistered = registerCodecBenchmarks();
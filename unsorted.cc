@@ -0,0 +1,190 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common.h"
+
+#include "benchmark/include/benchmark/benchmark.h"
+#include "SIMDCompressionAndIntersection/include/codecs.h"
+#include "SIMDCompressionAndIntersection/include/variablebyte.h"
+
+// Distributions of the unsorted columns, to be passed as state.range(0).
+enum UnsortedDistribution {
+  // Uniform in [0, 2^24), like foreign keys into a large table.
+  UNSORTED_UNIFORM,
+  // Zipf (exponent 1) over [0, 2^16), like counts or lengths: small values
+  // are the most frequent.
+  UNSORTED_ZIPF,
+  // Uniform in [2^20, 2^20 + 1024): few bits once the minimum is subtracted.
+  UNSORTED_SMALL_RANGE,
+  // Signed, normal with mean 0 and standard deviation 1000, zigzag encoded.
+  UNSORTED_SIGNED
+};
+
+static const char *distributionName(int distribution) {
+  switch (distribution) {
+    case UNSORTED_UNIFORM: return "uniform";
+    case UNSORTED_ZIPF: return "zipf";
+    case UNSORTED_SMALL_RANGE: return "smallrange";
+    case UNSORTED_SIGNED: return "signed";
+  }
+  return "unknown";
+}
+
+// Maps signed integers to unsigned ones so that small magnitudes, positive
+// or negative, give small values: 0, -1, 1, -2, 2... become 0, 1, 2, 3, 4...
+static inline uint32_t zigzagEncode(int32_t value) {
+  return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+class UnsortedInt32 : public benchmark::Fixture {
+private:
+  void generate(int distribution, size_t len) {
+    std::mt19937_64 generator(5);
+    std::vector<uint32_t> v(len);
+
+    switch (distribution) {
+      case UNSORTED_UNIFORM: {
+        std::uniform_int_distribution<uint32_t> dist(0, (1u << 24) - 1);
+        for (size_t i = 0; i < len; ++i) {
+          v[i] = dist(generator);
+        }
+        break;
+      }
+      case UNSORTED_ZIPF: {
+        ZipfDistribution dist(1 << 16, 1.0);
+        for (size_t i = 0; i < len; ++i) {
+          v[i] = static_cast<uint32_t>(dist(generator));
+        }
+        break;
+      }
+      case UNSORTED_SMALL_RANGE: {
+        std::uniform_int_distribution<uint32_t> dist(1u << 20, (1u << 20) + 1023);
+        for (size_t i = 0; i < len; ++i) {
+          v[i] = dist(generator);
+        }
+        break;
+      }
+      case UNSORTED_SIGNED: {
+        std::normal_distribution<double> dist(0.0, 1000.0);
+        for (size_t i = 0; i < len; ++i) {
+          v[i] = zigzagEncode(static_cast<int32_t>(std::lround(dist(generator))));
+        }
+        break;
+      }
+    }
+
+    data[std::make_pair(distribution, len)] = v;
+  }
+
+public:
+  static std::map<std::pair<int, size_t>, std::vector<uint32_t> > data;
+
+  void SetUp(const ::benchmark::State& state) {
+    const std::pair<int, size_t> key(static_cast<int>(state.range(0)), static_cast<size_t>(state.range(1)));
+
+    if (data.find(key) == data.end()) {
+      generate(key.first, key.second);
+    }
+  }
+
+  void TearDown(const ::benchmark::State& state) {}
+};
+
+std::map<std::pair<int, size_t>, std::vector<uint32_t> > UnsortedInt32::data =
+  std::map<std::pair<int, size_t>, std::vector<uint32_t> >();
+
+static std::vector<uint32_t>& columnOf(const benchmark::State& state) {
+  return UnsortedInt32::data[std::make_pair(static_cast<int>(state.range(0)), static_cast<size_t>(state.range(1)))];
+}
+
+static void benchmarkCodecEncode(UnsortedInt32* obj, const CodecDescriptor& desc, benchmark::State& state) {
+  std::vector<uint32_t>& data = columnOf(state);
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = desc.create();
+  if (!codec) {
+    state.SkipWithError("codec not available");
+    return;
+  }
+  SIMDCompressionLib::VByte<false> fallbackCodec;
+  SIMDCompressionUtil comp(*codec, desc.blockSize, data, fallbackCodec, 0);
+  CompressionStats stats(state);
+
+  for (auto _ : state) {
+    stats.PauseTiming();
+    comp.Reset();
+    stats.ResumeTiming();
+
+    comp.Encode();
+  }
+
+  state.SetLabel(distributionName(static_cast<int>(state.range(0))));
+  stats.SetInputLengthInBytes(comp.InputLength() * sizeof(uint32_t));
+  stats.SetEncodedLengthInBytes(comp.EncodedLength() * sizeof(uint32_t));
+  stats.SetFinalStats();
+}
+
+static void benchmarkCodecDecode(UnsortedInt32* obj, const CodecDescriptor& desc, benchmark::State& state) {
+  std::vector<uint32_t>& data = columnOf(state);
+  std::shared_ptr<SIMDCompressionLib::IntegerCODEC> codec = desc.create();
+  if (!codec) {
+    state.SkipWithError("codec not available");
+    return;
+  }
+  SIMDCompressionLib::VByte<false> fallbackCodec;
+  SIMDCompressionUtil comp(*codec, desc.blockSize, data, fallbackCodec, 0);
+
+  comp.Encode();
+
+  CompressionStats stats(state);
+
+  for (auto _ : state) {
+    comp.Decode();
+  }
+
+  state.SetLabel(distributionName(static_cast<int>(state.range(0))));
+  stats.SetInputLengthInBytes(comp.InputLength() * sizeof(uint32_t));
+  stats.SetEncodedLengthInBytes(comp.EncodedLength() * sizeof(uint32_t));
+  stats.SetFinalStats();
+
+  comp.EqualityCheck();
+}
+
+BENCHMARK_DEFINE_F(UnsortedInt32, Copy)(benchmark::State& state) {
+  std::vector<uint32_t>& data = columnOf(state);
+  std::vector<uint32_t> copyTo(data.size());
+  CompressionStats stats(state);
+
+  for (auto _ : state)
+    std::copy(data.begin(), data.end(), copyTo.begin());
+
+  state.SetLabel(distributionName(static_cast<int>(state.range(0))));
+  stats.SetInputLengthInBytes(data.size() * sizeof(uint32_t));
+  stats.SetEncodedLengthInBytes(data.size() * sizeof(uint32_t));
+  stats.SetFinalStats();
+}
+
+BENCHMARK_REGISTER_F(UnsortedInt32, Copy)
+  ->ArgsProduct({{UNSORTED_UNIFORM, UNSORTED_ZIPF, UNSORTED_SMALL_RANGE, UNSORTED_SIGNED}, {1000, 100000, 1000000}});
+
+static bool registerCodecBenchmarks() {
+  for (auto b : RegisterCodecBenchmarks<UnsortedInt32>("UnsortedInt32", "Encode", benchmarkCodecEncode, UnsortedCodecTable())) {
+    b->ArgsProduct({{UNSORTED_UNIFORM, UNSORTED_ZIPF, UNSORTED_SMALL_RANGE, UNSORTED_SIGNED}, {1000, 100000, 1000000}});
+  }
+
+  for (auto b : RegisterCodecBenchmarks<UnsortedInt32>("UnsortedInt32", "Decode", benchmarkCodecDecode, UnsortedCodecTable())) {
+    b->ArgsProduct({{UNSORTED_UNIFORM, UNSORTED_ZIPF, UNSORTED_SMALL_RANGE, UNSORTED_SIGNED}, {1000, 100000, 1000000}});
+  }
+
+  return true;
+}
+
+static bool codecBenchmarksRegistered = registerCodecBenchmarks();
@@ -0,0 +1,484 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#include "updatableset.h"
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "common.h"
+
+UpdatableSortedSet::UpdatableSortedSet(
+  SIMDCompressionLib::IntegerCODEC& codec,
+  size_t blockSize,
+  size_t blockLength,
+  size_t bufferLength): _codec(codec), _blockSize(blockSize), _blockLength(blockLength),
+    _bufferLength(bufferLength), _numMerges(0)
+{
+  if (blockLength == 0 || bufferLength == 0) {
+    throw std::logic_error("block and buffer lengths must be positive");
+  }
+
+  Build(NULL, 0);
+}
+
+size_t UpdatableSortedSet::findBlock(uint32_t value) const {
+  // The first block also owns the values below its first integer.
+  size_t low = 1, high = _blocks.size();
+
+  while (low < high) {
+    const size_t middle = (low + high) / 2;
+
+    if (_blocks[middle].minValue <= value) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  return low - 1;
+}
+
+void UpdatableSortedSet::encodeBlock(Block& block, const uint32_t *values, size_t length) {
+  block.length = static_cast<uint32_t>(length);
+  block.encoded.clear();
+
+  if (length == 0) {
+    return;
+  }
+
+  // Some codecs overwrite their input.
+  _scratch.assign(values, values + length);
+  if (_encodeBuffer.size() < length + 1024) {
+    _encodeBuffer.resize(length + 1024);
+  }
+
+  const size_t encodedLength = EncodeWithFallback(_codec, _fallbackCodec, _blockSize,
+    _scratch.data(), length, _encodeBuffer.data(), _encodeBuffer.size());
+  block.encoded.assign(_encodeBuffer.begin(), _encodeBuffer.begin() + encodedLength);
+}
+
+void UpdatableSortedSet::decodeBlock(const Block& block, uint32_t *out) {
+  if (block.length) {
+    DecodeWithFallback(_codec, _fallbackCodec, _blockSize,
+      block.encoded.data(), block.encoded.size(), out, block.length);
+  }
+}
+
+size_t UpdatableSortedSet::applyUpdates(const Block& block, const uint32_t *values, uint32_t *out) const {
+  const std::vector<uint32_t>& inserts = block.inserts;
+  const std::vector<uint32_t>& tombstones = block.tombstones;
+  size_t i = 0, j = 0, t = 0, length = 0;
+
+  // A value is never both inserted and deleted, so the tombstones only need
+  // to be checked against the encoded integers.
+  while (i < block.length || j < inserts.size()) {
+    if (j == inserts.size() || (i < block.length && values[i] < inserts[j])) {
+      const uint32_t value = values[i++];
+
+      while (t < tombstones.size() && tombstones[t] < value) {
+        t++;
+      }
+      if (t == tombstones.size() || tombstones[t] != value) {
+        out[length++] = value;
+      }
+    } else {
+      if (i < block.length && values[i] == inserts[j]) {
+        i++;
+      }
+      out[length++] = inserts[j++];
+    }
+  }
+
+  return length;
+}
+
+void UpdatableSortedSet::mergeBlock(size_t index) {
+  Block& block = _blocks[index];
+
+  _scratch.resize(block.length + _blockSize);
+  decodeBlock(block, _scratch.data());
+  _merged.resize(block.length + block.inserts.size());
+
+  const size_t length = applyUpdates(block, _scratch.data(), _merged.data());
+
+  block.inserts.clear();
+  block.tombstones.clear();
+
+  if (length == 0 && _blocks.size() > 1) {
+    _blocks.erase(_blocks.begin() + index);
+    return;
+  }
+
+  if (length <= _blockLength + _blockLength / 2) {
+    encodeBlock(block, _merged.data(), length);
+    return;
+  }
+
+  // Too long: split in blocks of about _blockLength integers. The first one
+  // keeps the range of the original block below the second one.
+  const size_t numBlocks = (length + _blockLength - 1) / _blockLength;
+  const size_t newLength = (length + numBlocks - 1) / numBlocks;
+  std::vector<Block> newBlocks(numBlocks - 1);
+
+  encodeBlock(block, _merged.data(), newLength);
+
+  for (size_t b = 1; b < numBlocks; ++b) {
+    const size_t start = b * newLength;
+    Block& newBlock = newBlocks[b - 1];
+
+    newBlock.minValue = _merged[start];
+    encodeBlock(newBlock, _merged.data() + start, std::min(newLength, length - start));
+  }
+
+  _blocks.insert(_blocks.begin() + index + 1,
+    std::make_move_iterator(newBlocks.begin()), std::make_move_iterator(newBlocks.end()));
+}
+
+void UpdatableSortedSet::Build(const uint32_t *data, size_t length) {
+  _blocks.clear();
+  _numMerges = 0;
+
+  for (size_t start = 0; start < length; start += _blockLength) {
+    _blocks.push_back(Block());
+    _blocks.back().minValue = data[start];
+    encodeBlock(_blocks.back(), data + start, std::min(_blockLength, length - start));
+  }
+
+  if (_blocks.empty()) {
+    _blocks.push_back(Block());
+    _blocks.back().minValue = 0;
+    _blocks.back().length = 0;
+  }
+}
+
+void UpdatableSortedSet::Insert(uint32_t value) {
+  const size_t index = findBlock(value);
+  Block& block = _blocks[index];
+  std::vector<uint32_t>::iterator it = std::lower_bound(block.tombstones.begin(), block.tombstones.end(), value);
+
+  if (it != block.tombstones.end() && *it == value) {
+    block.tombstones.erase(it);
+  }
+
+  it = std::lower_bound(block.inserts.begin(), block.inserts.end(), value);
+  if (it == block.inserts.end() || *it != value) {
+    block.inserts.insert(it, value);
+  }
+
+  if (block.inserts.size() + block.tombstones.size() >= _bufferLength) {
+    mergeBlock(index);
+    _numMerges++;
+  }
+}
+
+void UpdatableSortedSet::Delete(uint32_t value) {
+  const size_t index = findBlock(value);
+  Block& block = _blocks[index];
+  std::vector<uint32_t>::iterator it = std::lower_bound(block.inserts.begin(), block.inserts.end(), value);
+
+  if (it != block.inserts.end() && *it == value) {
+    block.inserts.erase(it);
+  }
+
+  it = std::lower_bound(block.tombstones.begin(), block.tombstones.end(), value);
+  if (it == block.tombstones.end() || *it != value) {
+    block.tombstones.insert(it, value);
+  }
+
+  if (block.inserts.size() + block.tombstones.size() >= _bufferLength) {
+    mergeBlock(index);
+    _numMerges++;
+  }
+}
+
+void UpdatableSortedSet::Compact() {
+  // From the last block, so that splitting or dropping a block does not move
+  // the ones still to be merged.
+  for (size_t b = _blocks.size(); b-- > 0; ) {
+    if (!_blocks[b].inserts.empty() || !_blocks[b].tombstones.empty()) {
+      mergeBlock(b);
+    }
+  }
+}
+
+size_t UpdatableSortedSet::Decode(uint32_t *out) {
+  size_t length = 0;
+
+  for (const Block& block : _blocks) {
+    if (block.inserts.empty() && block.tombstones.empty()) {
+      decodeBlock(block, out + length);
+      length += block.length;
+    } else {
+      _scratch.resize(block.length + _blockSize);
+      decodeBlock(block, _scratch.data());
+      length += applyUpdates(block, _scratch.data(), out + length);
+    }
+  }
+
+  return length;
+}
+
+size_t UpdatableSortedSet::MaxLength() const {
+  size_t length = 0;
+
+  for (const Block& block : _blocks) {
+    length += block.length + block.inserts.size();
+  }
+
+  return length;
+}
+
+size_t UpdatableSortedSet::NumBlocks() const {
+  return _blocks.size();
+}
+
+size_t UpdatableSortedSet::PendingUpdates() const {
+  size_t updates = 0;
+
+  for (const Block& block : _blocks) {
+    updates += block.inserts.size() + block.tombstones.size();
+  }
+
+  return updates;
+}
+
+size_t UpdatableSortedSet::NumMerges() const {
+  return _numMerges;
+}
+
+size_t UpdatableSortedSet::EncodedLengthInBytes() const {
+  size_t words = 0;
+
+  // The first value and the length of every block take two words.
+  for (const Block& block : _blocks) {
+    words += 2 + block.encoded.size() + block.inserts.size() + block.tombstones.size();
+  }
+
+  return words * sizeof(uint32_t);
+}
+
+struct SetUpdate {
+  uint32_t list;
+  uint32_t value;
+  bool insert;
+};
+
+// Draws `numUpdates` updates, each one an insert with probability
+// `insertShare`. The lists are picked in proportion to their length.
+static std::vector<SetUpdate> generateUpdates(
+  const std::vector<std::vector<uint32_t> >& lists,
+  size_t numUpdates,
+  double insertShare,
+  uint64_t seed)
+{
+  std::mt19937 generator(seed);
+  std::vector<size_t> lengths;
+  std::bernoulli_distribution isInsert(insertShare);
+  std::vector<SetUpdate> updates(numUpdates);
+
+  for (const std::vector<uint32_t>& list : lists) {
+    lengths.push_back(list.size());
+  }
+
+  std::discrete_distribution<size_t> randomList(lengths.begin(), lengths.end());
+
+  for (SetUpdate& update : updates) {
+    const size_t l = randomList(generator);
+    const std::vector<uint32_t>& list = lists[l];
+
+    update.list = static_cast<uint32_t>(l);
+    update.insert = isInsert(generator);
+
+    if (update.insert) {
+      // There are at least list.size() + 1 values in the range that are not
+      // in the list.
+      std::uniform_int_distribution<uint64_t> randomValue(0, std::min(uint64_t(list.back()) + list.size(), uint64_t(UINT32_MAX)));
+
+      do {
+        update.value = static_cast<uint32_t>(randomValue(generator));
+      } while (std::binary_search(list.begin(), list.end(), update.value));
+    } else {
+      std::uniform_int_distribution<size_t> randomIndex(0, list.size() - 1);
+      update.value = list[randomIndex(generator)];
+    }
+  }
+
+  return updates;
+}
+
+// The lists after the updates, as computed with plain sorted vectors.
+static std::vector<std::vector<uint32_t> > updatedLists(
+  const std::vector<std::vector<uint32_t> >& lists,
+  const std::vector<SetUpdate>& updates)
+{
+  std::vector<std::vector<uint32_t> > inserts(lists.size()), deletes(lists.size());
+  std::vector<std::vector<uint32_t> > result(lists.size());
+
+  for (const SetUpdate& update : updates) {
+    (update.insert ? inserts : deletes)[update.list].push_back(update.value);
+  }
+
+  for (size_t l = 0; l < lists.size(); ++l) {
+    std::vector<uint32_t> remaining;
+
+    std::sort(inserts[l].begin(), inserts[l].end());
+    inserts[l].erase(std::unique(inserts[l].begin(), inserts[l].end()), inserts[l].end());
+    std::sort(deletes[l].begin(), deletes[l].end());
+    std::set_difference(lists[l].begin(), lists[l].end(), deletes[l].begin(), deletes[l].end(),
+      std::back_inserter(remaining));
+    std::set_union(remaining.begin(), remaining.end(), inserts[l].begin(), inserts[l].end(),
+      std::back_inserter(result[l]));
+  }
+
+  return result;
+}
+
+void BenchmarkSetUpdates(
+  SIMDCompressionLib::IntegerCODEC& codec,
+  size_t blockSize,
+  const std::vector<std::vector<uint32_t> >& lists,
+  SetUpdateBenchmark operation,
+  size_t perMille,
+  benchmark::State& state)
+{
+  size_t totalLength = 0;
+
+  for (const std::vector<uint32_t>& list : lists) {
+    totalLength += list.size();
+  }
+
+  if (totalLength == 0) {
+    state.SkipWithError("no integers to update");
+    return;
+  }
+
+  const double insertShare = (operation == SET_UPDATE_INSERT) ? 1.0 : ((operation == SET_UPDATE_DELETE) ? 0.0 : 0.5);
+  const std::vector<SetUpdate> updates = generateUpdates(lists,
+    std::max(totalLength * perMille / 1000, size_t(1)), insertShare, 1234);
+  std::vector<std::unique_ptr<UpdatableSortedSet> > sets;
+
+  for (size_t l = 0; l < lists.size(); ++l) {
+    sets.emplace_back(new UpdatableSortedSet(codec, blockSize));
+  }
+
+  auto build = [&]() {
+    for (size_t l = 0; l < lists.size(); ++l) {
+      sets[l]->Build(lists[l].data(), lists[l].size());
+    }
+  };
+
+  auto apply = [&]() {
+    for (const SetUpdate& update : updates) {
+      if (update.insert) {
+        sets[update.list]->Insert(update.value);
+      } else {
+        sets[update.list]->Delete(update.value);
+      }
+    }
+  };
+
+  auto compact = [&]() {
+    for (std::unique_ptr<UpdatableSortedSet>& set : sets) {
+      set->Compact();
+    }
+  };
+
+  auto decode = [&](uint32_t *out) {
+    size_t length = 0;
+    for (std::unique_ptr<UpdatableSortedSet>& set : sets) {
+      length += set->Decode(out + length);
+    }
+    return length;
+  };
+
+  const bool readBenchmark = (operation == SET_UPDATE_READ || operation == SET_UPDATE_READ_COMPACTED);
+  size_t pendingUpdates = 0;
+  size_t decodedLength = 0;
+  std::vector<uint32_t> decoded;
+
+  if (readBenchmark) {
+    build();
+    apply();
+    if (operation == SET_UPDATE_READ_COMPACTED) {
+      compact();
+    }
+
+    size_t maxLength = 0;
+    for (std::unique_ptr<UpdatableSortedSet>& set : sets) {
+      maxLength += set->MaxLength();
+      pendingUpdates += set->PendingUpdates();
+    }
+
+    const std::vector<std::vector<uint32_t> > expected = updatedLists(lists, updates);
+    decoded.resize(maxLength + blockSize);
+
+    for (size_t l = 0; l < lists.size(); ++l) {
+      const size_t listLength = sets[l]->Decode(decoded.data());
+      if (listLength != expected[l].size() || !std::equal(expected[l].begin(), expected[l].end(), decoded.begin())) {
+        throw std::logic_error("equality check failed");
+      }
+      decodedLength += listLength;
+    }
+  }
+
+  CompressionStats stats(state);
+
+  if (readBenchmark) {
+    for (auto _ : state) {
+      decode(decoded.data());
+      benchmark::DoNotOptimize(decoded.data());
+    }
+
+    stats.SetInputLengthInBytes(decodedLength * sizeof(uint32_t));
+  } else {
+    for (auto _ : state) {
+      stats.PauseTiming();
+      build();
+      if (operation == SET_UPDATE_COMPACT) {
+        apply();
+        pendingUpdates = 0;
+        for (std::unique_ptr<UpdatableSortedSet>& set : sets) {
+          pendingUpdates += set->PendingUpdates();
+        }
+      }
+      stats.ResumeTiming();
+
+      if (operation == SET_UPDATE_COMPACT) {
+        compact();
+      } else {
+        apply();
+      }
+    }
+
+    if (operation != SET_UPDATE_COMPACT) {
+      size_t numMerges = 0;
+      for (std::unique_ptr<UpdatableSortedSet>& set : sets) {
+        numMerges += set->NumMerges();
+        pendingUpdates += set->PendingUpdates();
+      }
+
+      state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(updates.size()));
+      state.counters["merges"] = numMerges;
+    }
+    stats.SetInputLengthInBytes(totalLength * sizeof(uint32_t));
+  }
+
+  size_t encodedLength = 0;
+  size_t numBlocks = 0;
+  for (std::unique_ptr<UpdatableSortedSet>& set : sets) {
+    encodedLength += set->EncodedLengthInBytes();
+    numBlocks += set->NumBlocks();
+  }
+
+  stats.SetEncodedLengthInBytes(encodedLength);
+  stats.SetFinalStats();
+  state.counters["updates"] = updates.size();
+  state.counters["pendingUpdates"] = pendingUpdates;
+  state.counters["blocks"] = numBlocks;
+}
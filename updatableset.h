@@ -0,0 +1,111 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#ifndef INTCOMPBENCH_UPDATABLESET_H_
+#define INTCOMPBENCH_UPDATABLESET_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "benchmark/include/benchmark/benchmark.h"
+#include "SIMDCompressionAndIntersection/include/codecs.h"
+#include "SIMDCompressionAndIntersection/include/variablebyte.h"
+
+// Sorted set of integers that takes inserts and deletes without re-encoding
+// the whole list. The set is split into blocks of about `blockLength`
+// integers, each one encoded on its own as SIMDCompressionUtil does. Every
+// block owns the range of values from its first integer to the first integer
+// of the next block, and keeps the updates to that range in two small sorted
+// buffers: the inserted values and the deleted ones (tombstones). Updates are
+// blind, that is, they do not look at the encoded integers, so an insert of
+// a value already in the block or a delete of a missing one are harmless.
+// When the buffers of a block reach `bufferLength` updates, the block is
+// merged: it is decoded, the updates are applied and it is encoded again,
+// split in two if it grew too long or dropped if it became empty.
+class UpdatableSortedSet {
+private:
+  struct Block {
+    uint32_t minValue;
+    uint32_t length;
+    std::vector<uint32_t> encoded;
+    std::vector<uint32_t> inserts;
+    std::vector<uint32_t> tombstones;
+  };
+
+  SIMDCompressionLib::VByte<true> _fallbackCodec;
+  SIMDCompressionLib::IntegerCODEC& _codec;
+  size_t _blockSize;
+  size_t _blockLength;
+  size_t _bufferLength;
+  std::vector<Block> _blocks;
+  size_t _numMerges;
+  std::vector<uint32_t> _scratch;
+  std::vector<uint32_t> _merged;
+  std::vector<uint32_t> _encodeBuffer;
+
+  size_t findBlock(uint32_t value) const;
+  void encodeBlock(Block& block, const uint32_t *values, size_t length);
+  void decodeBlock(const Block& block, uint32_t *out);
+  size_t applyUpdates(const Block& block, const uint32_t *values, uint32_t *out) const;
+  void mergeBlock(size_t index);
+
+public:
+  UpdatableSortedSet(
+    SIMDCompressionLib::IntegerCODEC& codec,
+    size_t blockSize,
+    size_t blockLength = 256,
+    size_t bufferLength = 64);
+
+  // Replaces the contents of the set with a sorted list without repeated
+  // values.
+  void Build(const uint32_t *data, size_t length);
+  void Insert(uint32_t value);
+  void Delete(uint32_t value);
+  // Merges every block with pending updates.
+  void Compact();
+  // Writes the integers of the set to `out`, in order, and returns how many
+  // there are. `out` must have room for MaxLength() integers.
+  size_t Decode(uint32_t *out);
+  // The encoded integers plus the inserted ones.
+  size_t MaxLength() const;
+  size_t NumBlocks() const;
+  size_t PendingUpdates() const;
+  // Number of blocks merged because their buffers were full.
+  size_t NumMerges() const;
+  // The encoded blocks and the update buffers.
+  size_t EncodedLengthInBytes() const;
+};
+
+// Operation measured by BenchmarkSetUpdates().
+enum SetUpdateBenchmark {
+  SET_UPDATE_INSERT,
+  SET_UPDATE_DELETE,
+  SET_UPDATE_COMPACT,
+  SET_UPDATE_READ,
+  SET_UPDATE_READ_COMPACTED
+};
+
+// Builds an UpdatableSortedSet for every list and measures one operation. The
+// number of updates is `perMille` thousandths of the integers of all lists,
+// spread at random among them; inserts are of values that are not in the
+// list and deletes of values that are.
+//
+// * SET_UPDATE_INSERT and SET_UPDATE_DELETE: applying the updates, all of
+//   them inserts or deletes, including the merges of the blocks whose
+//   buffers fill up. items_per_second is updates per second.
+// * SET_UPDATE_COMPACT: merging every block after half inserts and half
+//   deletes.
+// * SET_UPDATE_READ and SET_UPDATE_READ_COMPACTED: decoding every set after
+//   half inserts and half deletes, before and after compacting it. The
+//   result is checked against the updated lists.
+void BenchmarkSetUpdates(
+  SIMDCompressionLib::IntegerCODEC& codec,
+  size_t blockSize,
+  const std::vector<std::vector<uint32_t> >& lists,
+  SetUpdateBenchmark operation,
+  size_t perMille,
+  benchmark::State& state);
+
+#endif // INTCOMPBENCH_UPDATABLESET_H_
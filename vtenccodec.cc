@@ -0,0 +1,62 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#include "vtenccodec.h"
+
+#include <stdexcept>
+#include <string>
+
+#include "VTEnc/vtenc.h"
+
+VTEncCodec::VTEncCodec(size_t minClusterLength, bool allowRepeatedValues) {
+  _handler = vtenc_create();
+  if (_handler == NULL) {
+    throw std::runtime_error("vtenc_create failed");
+  }
+
+  vtenc_config(_handler, VTENC_CONFIG_ALLOW_REPEATED_VALUES, allowRepeatedValues ? 1 : 0);
+  vtenc_config(_handler, VTENC_CONFIG_SKIP_FULL_SUBTREES, 1);
+  vtenc_config(_handler, VTENC_CONFIG_MIN_CLUSTER_LENGTH, minClusterLength);
+}
+
+VTEncCodec::~VTEncCodec() {
+  vtenc_destroy(_handler);
+}
+
+void VTEncCodec::encodeArray(uint32_t *in, const size_t length, uint32_t *out, size_t &nvalue) {
+  uint8_t *encoded = reinterpret_cast<uint8_t *>(out + 2);
+  size_t capacity = (nvalue - 2) * sizeof(uint32_t);
+
+  if (vtenc_encode32(_handler, in, length, encoded, capacity) != VTENC_OK) {
+    throw std::runtime_error("vtenc_encode32 failed");
+  }
+
+  size_t encodedLength = vtenc_encoded_size(_handler);
+
+  out[0] = static_cast<uint32_t>(length);
+  out[1] = static_cast<uint32_t>(encodedLength);
+  nvalue = 2 + (encodedLength + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+}
+
+const uint32_t *VTEncCodec::decodeArray(const uint32_t *in, const size_t length, uint32_t *out, size_t &nvalue) {
+  const size_t count = in[0];
+  const size_t encodedLength = in[1];
+  const uint8_t *encoded = reinterpret_cast<const uint8_t *>(in + 2);
+
+  if (count > nvalue) {
+    throw std::logic_error("output buffer too small for VTEnc");
+  }
+
+  if (vtenc_decode32(_handler, encoded, encodedLength, out, count) != VTENC_OK) {
+    throw std::runtime_error("vtenc_decode32 failed");
+  }
+
+  nvalue = count;
+
+  return in + 2 + (encodedLength + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+}
+
+std::string VTEncCodec::name() const {
+  return std::string("VTEnc");
+}
@@ -0,0 +1,34 @@
+// Copyright (c) 2019 Vicente Romero Calero. All rights reserved.
+// Licensed under the MIT License.
+// See LICENSE file in the project root for full license information.
+
+#ifndef INTCOMPBENCH_VTENCCODEC_H_
+#define INTCOMPBENCH_VTENCCODEC_H_
+
+#include <string>
+
+#include "SIMDCompressionAndIntersection/include/codecs.h"
+#include "VTEnc/vtenc.h"
+
+// Exposes VTEnc through the SIMDCompressionAndIntersection codec interface, so
+// that it can be used wherever the other codecs are. The VTEnc stream is
+// preceded by two words: the number of integers and the length of the stream
+// in bytes, which is padded to a whole number of words. Unless
+// `allowRepeatedValues` is set, the input must be strictly increasing.
+class VTEncCodec : public SIMDCompressionLib::IntegerCODEC {
+private:
+  vtenc *_handler;
+
+  VTEncCodec(const VTEncCodec&);
+  VTEncCodec& operator=(const VTEncCodec&);
+
+public:
+  VTEncCodec(size_t minClusterLength = 1, bool allowRepeatedValues = false);
+  ~VTEncCodec();
+
+  void encodeArray(uint32_t *in, const size_t length, uint32_t *out, size_t &nvalue);
+  const uint32_t *decodeArray(const uint32_t *in, const size_t length, uint32_t *out, size_t &nvalue);
+  std::string name() const;
+};
+
+#endif // INTCOMPBENCH_VTENCCODEC_H_